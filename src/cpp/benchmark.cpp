@@ -1,90 +1,50 @@
-#include <iostream>
-#include <chrono>
-#include <thread>
+#include "benchmark.hpp"
 
-#include "queue.hpp"
+struct StampedTraits : DefaultQueueTraits {
+    using Layout = StampedLayout<>;
+};
 
-void pinToCore(size_t core_id) {
-    cpu_set_t cpuset;
+/* only the consumer batches: the RTT loop would stall on unflushed pushes */
+struct LazyReleaseTraits : DefaultQueueTraits {
+    static constexpr size_t consumer_batch = 32;
+};
 
-    CPU_ZERO(&cpuset);
-    CPU_SET(core_id, &cpuset);
+struct PrefetchTraits : DefaultQueueTraits {
+    using Prefetch = PrefetchAhead<>;
+};
 
-    if (sched_setaffinity(0, sizeof(cpuset), &cpuset) != 0) {
-        perror("sched_setaffinity");
-        std::terminate();
-    }
-}
-
-constexpr size_t iterations = 10'000'000;
-size_t slots = recommendedSlots<uint64_t>();
-
-void producerThroughput(SPSCQueue<uint64_t>* q, size_t core) {
-    pinToCore(core);
-
-    for (uint64_t i = 0; i < iterations; ++i) {
-        q->push(i);
-    }
-}
-
-void consumerThroughput(SPSCQueue<uint64_t>* q, size_t core) {
-    pinToCore(core);
-
-    for (uint64_t i = 0; i < iterations; ++i) {
-        uint64_t val = q->pop();
-    }
-}
+/* throughput only, like producer batching it would stall the RTT loop */
+struct WholeLineTraits : DefaultQueueTraits {
+    static constexpr bool publish_whole_lines = true;
+};
 
-void producerRTT(SPSCQueue<uint64_t>* q1, SPSCQueue<uint64_t>* q2, size_t core) {
-    pinToCore(core);
+template<typename T>
+using DefaultQueue = SPSCQueue<T>;
 
-    for (uint64_t i = 0; i < iterations; ++i) {
-        q1->push(i);
-        uint64_t x = q2->pop();
-    }
-}
-
-void consumerRTT(SPSCQueue<uint64_t>* q1, SPSCQueue<uint64_t>* q2, size_t core) {
-    pinToCore(core);
-
-    for (uint64_t i = 0; i < iterations; ++i) {
-        uint64_t val = q1->pop();
-        q2->push(val);
-    }
-}
+template<typename T>
+using StampedQueue = SPSCQueue<T, dynamic_slots, StampedTraits>;
 
-int main() {
-    size_t const core1 = 0, core2 = 1;
+template<typename T>
+using PrefetchQueue = SPSCQueue<T, dynamic_slots, PrefetchTraits>;
 
-    {
-        SPSCQueue<uint64_t> queue(slots);
+template<typename T>
+using LazyReleaseQueue = SPSCQueue<T, dynamic_slots, LazyReleaseTraits>;
 
-        std::thread consumer_thread(consumerThroughput, &queue, core1);
-        auto start = std::chrono::high_resolution_clock::now();
-        producerThroughput(&queue, core2);
-        consumer_thread.join();
-        auto end = std::chrono::high_resolution_clock::now();
+template<typename T>
+using WholeLineQueue = SPSCQueue<T, dynamic_slots, WholeLineTraits>;
 
-        uint64_t elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
-        uint64_t ops_per_ms = (iterations * 1'000'000) / elapsed_ns;
+int main(int argc, char** argv) {
+    BenchConfig const config = parseArgs(argc, argv);
+    Reporter reporter(config.format);
 
-        std::cout << ops_per_ms << " ops/ms\n";
-    }
+    runQueue<DefaultQueue>("SPSCQueue", config, reporter);
+    runQueue<StampedQueue>("SPSCQueue<StampedLayout>", config, reporter);
+    runQueue<PrefetchQueue>("SPSCQueue<PrefetchAhead>", config, reporter);
+    runQueue<LazyReleaseQueue>("SPSCQueue<consumer_batch=32>", config, reporter);
 
-    {
-        SPSCQueue<uint64_t> q1(slots);
-        SPSCQueue<uint64_t> q2(slots);
-
-        std::thread consumer_thread(consumerRTT, &q1, &q2, core1);
-        auto start = std::chrono::high_resolution_clock::now();
-        producerRTT(&q1, &q2, core2);
-        auto end = std::chrono::high_resolution_clock::now();
-        consumer_thread.join();
-
-        uint64_t elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
-
-        std::cout << (elapsed_ns / iterations) << " ns RTT\n";
-    }
+    BenchConfig throughput_only = config;
+    throughput_only.rtt = false;
+    if (throughput_only.throughput) runQueue<WholeLineQueue>("SPSCQueue<whole_lines>", throughput_only, reporter);
 
     return 0;
-}
\ No newline at end of file
+}
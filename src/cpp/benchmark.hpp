@@ -0,0 +1,544 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) Andrea Vaccaro
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Source: https://github.com/ANDRVV/SPSCQueue
+ * Benchmark harness: pinning, trials, RTT histograms and reporting.
+ * A queue is benchmarked through an adapter template Queue<T> providing
+ * Queue(size_t slots), void push(const T&) and T pop().
+ */
+
+#pragma once
+
+#include <sched.h>
+
+#ifdef __linux__
+    #include <linux/perf_event.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "histogram_buckets.hpp"
+#include "queue.hpp"
+#include "topology.hpp"
+#include "tsc.hpp"
+
+inline void
+pinToCore(size_t core_id) {
+    cpu_set_t cpuset;
+
+    CPU_ZERO(&cpuset);
+    CPU_SET(core_id, &cpuset);
+
+    if (sched_setaffinity(0, sizeof(cpuset), &cpuset) != 0) {
+        perror("sched_setaffinity");
+        std::terminate();
+    }
+}
+
+/* Counts the calling thread's L1D read misses. valid() is false where
+ * perf events are unavailable (e.g. perf_event_paranoid, containers). */
+class L1MissCounter {
+private:
+    int fd = -1;
+
+public:
+    L1MissCounter() noexcept {
+#ifdef __linux__
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                    | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+    }
+
+    ~L1MissCounter() {
+#ifdef __linux__
+        if (fd >= 0) close(fd);
+#endif
+    }
+
+    L1MissCounter(const L1MissCounter&) = delete;
+    L1MissCounter& operator=(const L1MissCounter&) = delete;
+
+    [[nodiscard]] bool valid() const noexcept { return fd >= 0; }
+
+    [[nodiscard]] uint64_t
+    read() const noexcept {
+        uint64_t count = 0;
+#ifdef __linux__
+        if (fd >= 0 && ::read(fd, &count, sizeof(count)) != sizeof(count)) count = 0;
+#endif
+        return count;
+    }
+};
+
+/* Log-linear histogram of round trips, see LogLinearBuckets. */
+class Histogram {
+private:
+    using Buckets = LogLinearBuckets<>;
+
+    std::vector<uint64_t> counts = std::vector<uint64_t>(Buckets::count, 0);
+    uint64_t total = 0;
+    uint64_t largest = 0;
+    long double sum = 0;
+
+public:
+    inline void
+    record(uint64_t value) noexcept {
+        ++counts[Buckets::bucketOf(value)];
+        ++total;
+        largest = std::max(largest, value);
+        sum += value;
+    }
+
+    void
+    merge(const Histogram& other) noexcept {
+        for (size_t i = 0; i < Buckets::count; ++i) counts[i] += other.counts[i];
+        total += other.total;
+        largest = std::max(largest, other.largest);
+        sum += other.sum;
+    }
+
+    /* Returns the value at percentile p in [0, 100]. */
+    [[nodiscard]] uint64_t
+    percentile(double p) const noexcept {
+        if (total == 0) return 0;
+        uint64_t const rank = std::max<uint64_t>(1, static_cast<uint64_t>(p / 100.0 * total + 0.5));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < Buckets::count; ++i) {
+            seen += counts[i];
+            if (seen >= rank) return std::min(Buckets::valueOf(i), largest);
+        }
+        return largest;
+    }
+
+    [[nodiscard]] uint64_t count() const noexcept { return total; }
+    [[nodiscard]] uint64_t max() const noexcept { return largest; }
+    [[nodiscard]] double mean() const noexcept { return total ? static_cast<double>(sum / total) : 0.0; }
+};
+
+struct CorePair {
+    size_t producer;
+    size_t consumer;
+    std::string label; /* placement class, e.g. "smt", "l2", "l3", "cross-socket" */
+};
+
+struct BenchConfig {
+    size_t trials = 10;
+    size_t iterations = 1'000'000;
+    size_t warmup = 100'000;
+    std::vector<CorePair> cores;
+    std::vector<size_t> payloads = {8};
+    std::vector<size_t> slots = {0}; /* 0 = recommendedSlots<T>() */
+    bool throughput = true;
+    bool rtt = true;
+    std::string format = "text";
+};
+
+/* payload sizes the benchmarks are compiled for */
+inline constexpr size_t payload_sizes[] = {8, 16, 32, 64, 128, 256, 512, 1024};
+
+template<size_t Bytes>
+struct Payload {
+    static_assert(Bytes % sizeof(uint64_t) == 0, "payload must be a multiple of 8 bytes");
+    uint64_t words[Bytes / sizeof(uint64_t)];
+};
+
+inline std::vector<size_t>
+parseList(const char* arg) {
+    std::vector<size_t> values;
+    for (const char* p = arg; *p != '\0';) {
+        char* end;
+        values.push_back(std::strtoull(p, &end, 10));
+        p = *end == ',' ? end + 1 : end;
+        if (end == p && *p != '\0') break;
+    }
+    return values;
+}
+
+[[noreturn]] inline void
+usage(const char* program) {
+    std::fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --trials N           timed trials per configuration (default 10)\n"
+        "  --iterations N       messages per trial (default 1000000)\n"
+        "  --warmup N           untimed messages before the trials (default 100000)\n"
+        "  --cores P,C[,LABEL]  producer/consumer core pair, repeatable (default 0,1)\n"
+        "  --sweep              one core pair per placement class (smt, l2, l3, ...)\n"
+        "  --suggest N          print up to N disjoint core pairs sharing an L2/L3 and exit\n"
+        "  --payload B[,B...]   payload sizes in bytes: 8 16 32 64 128 256 512 1024 (default 8)\n"
+        "  --slots S[,S...]     ring capacities, 0 = recommendedSlots<T>() (default 0)\n"
+        "  --mode M             throughput, rtt or all (default all)\n"
+        "  --format F           text, csv or json (default text)\n",
+        program);
+    std::exit(1);
+}
+
+/* Parses the options common to every benchmark binary. Unknown options
+ * are passed to extra(), which returns how many arguments it consumed. */
+template<typename Extra>
+BenchConfig
+parseArgs(int argc, char** argv, Extra&& extra) {
+    BenchConfig config;
+    std::vector<CpuInfo> const topology = readCpuTopology();
+    /* labels a pair with its placement class unless the user named it */
+    auto const label = [&](size_t producer, size_t consumer) -> std::string {
+        auto const producer_info = std::find_if(topology.begin(), topology.end(),
+                                                [&](const CpuInfo& c) { return c.cpu == producer; });
+        auto const consumer_info = std::find_if(topology.begin(), topology.end(),
+                                                [&](const CpuInfo& c) { return c.cpu == consumer; });
+        if (producer_info == topology.end() || consumer_info == topology.end()) return "";
+        return placementName(placementOf(*producer_info, *consumer_info));
+    };
+
+    for (int i = 1; i < argc; ++i) {
+        std::string const arg = argv[i];
+        bool const has_value = i + 1 < argc;
+        if (arg == "--trials" && has_value) {
+            config.trials = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--iterations" && has_value) {
+            config.iterations = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--warmup" && has_value) {
+            config.warmup = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--cores" && has_value) {
+            std::string const value = argv[++i];
+            std::vector<size_t> const pair = parseList(value.c_str());
+            if (pair.size() < 2) usage(argv[0]);
+            size_t const named = value.find(',', value.find(',') + 1);
+            config.cores.push_back({pair[0], pair[1],
+                                    named == std::string::npos ? label(pair[0], pair[1]) : value.substr(named + 1)});
+        } else if (arg == "--sweep") {
+            for (const CpuPair& pair : representativePairs(topology)) {
+                config.cores.push_back({pair.producer, pair.consumer, placementName(pair.placement)});
+            }
+            if (config.cores.empty()) {
+                std::fprintf(stderr, "%s: no two usable CPUs found in /sys/devices/system/cpu\n", argv[0]);
+                std::exit(1);
+            }
+        } else if (arg == "--suggest" && has_value) {
+            /* P,C,LABEL lines, ready to be passed back with --cores */
+            for (const CpuPair& pair : suggestCorePairs(topology, std::strtoull(argv[++i], nullptr, 10))) {
+                std::printf("%zu,%zu,%s\n", pair.producer, pair.consumer, placementName(pair.placement));
+            }
+            std::exit(0);
+        } else if (arg == "--payload" && has_value) {
+            config.payloads = parseList(argv[++i]);
+        } else if (arg == "--slots" && has_value) {
+            config.slots = parseList(argv[++i]);
+        } else if (arg == "--mode" && has_value) {
+            std::string const mode = argv[++i];
+            config.throughput = mode == "throughput" || mode == "all";
+            config.rtt = mode == "rtt" || mode == "all";
+            if (!config.throughput && !config.rtt) usage(argv[0]);
+        } else if (arg == "--format" && has_value) {
+            config.format = argv[++i];
+            if (config.format != "text" && config.format != "csv" && config.format != "json") usage(argv[0]);
+        } else {
+            int const consumed = extra(argc - i, argv + i);
+            if (consumed <= 0) usage(argv[0]);
+            i += consumed - 1;
+        }
+    }
+    if (config.cores.empty()) config.cores.push_back({0, 1, label(0, 1)});
+    for (size_t bytes : config.payloads) {
+        if (std::find(std::begin(payload_sizes), std::end(payload_sizes), bytes) == std::end(payload_sizes)) {
+            usage(argv[0]);
+        }
+    }
+    return config;
+}
+
+inline BenchConfig
+parseArgs(int argc, char** argv) {
+    return parseArgs(argc, argv, [](int, char**) { return 0; });
+}
+
+struct BenchResult {
+    std::string queue;
+    size_t payload;
+    size_t slots;
+    CorePair cores;
+    std::vector<double> throughput; /* ops/ms of each trial */
+    std::vector<double> l1_misses; /* L1D read misses per message of each throughput trial, both threads */
+    Histogram rtt; /* round trips in cycle counter ticks */
+    double rtt_mean_ns = 0; /* wall clock round trip, including timestamping */
+};
+
+/* Returns the nearest-rank percentile p of sorted. */
+inline double
+percentileOf(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    size_t const rank = static_cast<size_t>(p / 100.0 * sorted.size() + 0.5);
+    return sorted[std::min(sorted.size() - 1, rank == 0 ? 0 : rank - 1)];
+}
+
+class Reporter {
+private:
+    std::string format;
+    bool first = true;
+
+public:
+    explicit Reporter(std::string format_) : format(std::move(format_)) {
+        if (format == "csv") {
+            std::printf("queue,payload,slots,producer_core,consumer_core,placement,trials,"
+                        "tput_p50_ops_ms,tput_p90_ops_ms,tput_p99_ops_ms,tput_min_ops_ms,tput_max_ops_ms,"
+                        "rtt_samples,rtt_p50_ns,rtt_p99_ns,rtt_p999_ns,rtt_max_ns,rtt_mean_ns,l1d_misses_per_op\n");
+        } else if (format == "json") {
+            std::printf("[\n");
+        } else {
+            std::printf("# cycle counter: %.3f ticks/ns\n", tscTicksPerNs());
+            std::printf("%-28s %7s %7s %9s %-12s %10s %10s %10s %8s %8s %8s %8s %7s\n",
+                        "queue", "payload", "slots", "cores", "placement",
+                        "tput p50", "tput p90", "tput p99", "rtt p50", "rtt p99", "p99.9", "rtt max", "l1d/op");
+        }
+    }
+
+    ~Reporter() {
+        if (format == "json") std::printf("\n]\n");
+    }
+
+    void
+    add(BenchResult result) {
+        std::sort(result.throughput.begin(), result.throughput.end());
+        std::sort(result.l1_misses.begin(), result.l1_misses.end());
+        /* median over the trials, -1 when not counted */
+        double const l1 = result.l1_misses.empty() ? -1 : percentileOf(result.l1_misses, 50);
+        double const ticks_per_ns = tscTicksPerNs();
+        auto ns = [&](uint64_t ticks) { return static_cast<double>(ticks) / ticks_per_ns; };
+        double const tput[] = {
+            percentileOf(result.throughput, 50), percentileOf(result.throughput, 90),
+            percentileOf(result.throughput, 99),
+            result.throughput.empty() ? 0 : result.throughput.front(),
+            result.throughput.empty() ? 0 : result.throughput.back(),
+        };
+        double const rtt[] = {
+            ns(result.rtt.percentile(50)), ns(result.rtt.percentile(99)),
+            ns(result.rtt.percentile(99.9)), ns(result.rtt.max()),
+        };
+        std::string const cores = std::to_string(result.cores.producer) + "," + std::to_string(result.cores.consumer);
+        char l1_value[32];
+        std::snprintf(l1_value, sizeof(l1_value), "%.3f", l1);
+        /* empty csv field, json null, "-" in text when not counted */
+        char const* const missing = format == "csv" ? "" : format == "json" ? "null" : "-";
+        char const* const l1_field = l1 < 0 ? missing : l1_value;
+
+        if (format == "csv") {
+            std::printf("%s,%zu,%zu,%zu,%zu,%s,%zu,%.0f,%.0f,%.0f,%.0f,%.0f,%llu,%.1f,%.1f,%.1f,%.1f,%.1f,%s\n",
+                        result.queue.c_str(), result.payload, result.slots, result.cores.producer,
+                        result.cores.consumer, result.cores.label.c_str(), result.throughput.size(),
+                        tput[0], tput[1], tput[2], tput[3], tput[4],
+                        static_cast<unsigned long long>(result.rtt.count()),
+                        rtt[0], rtt[1], rtt[2], rtt[3], result.rtt_mean_ns, l1_field);
+        } else if (format == "json") {
+            std::printf("%s  {\"queue\": \"%s\", \"payload\": %zu, \"slots\": %zu, "
+                        "\"producer_core\": %zu, \"consumer_core\": %zu, \"placement\": \"%s\", "
+                        "\"throughput_ops_ms\": {\"trials\": %zu, \"p50\": %.0f, \"p90\": %.0f, \"p99\": %.0f, "
+                        "\"min\": %.0f, \"max\": %.0f}, "
+                        "\"rtt_ns\": {\"samples\": %llu, \"p50\": %.1f, \"p99\": %.1f, \"p999\": %.1f, "
+                        "\"max\": %.1f, \"mean\": %.1f}, \"l1d_misses_per_op\": %s}",
+                        first ? "" : ",\n", result.queue.c_str(), result.payload, result.slots,
+                        result.cores.producer, result.cores.consumer, result.cores.label.c_str(),
+                        result.throughput.size(), tput[0], tput[1], tput[2], tput[3], tput[4],
+                        static_cast<unsigned long long>(result.rtt.count()),
+                        rtt[0], rtt[1], rtt[2], rtt[3], result.rtt_mean_ns, l1_field);
+        } else {
+            std::printf("%-28s %7zu %7zu %9s %-12s %10.0f %10.0f %10.0f %8.0f %8.0f %8.0f %8.0f %7s\n",
+                        result.queue.c_str(), result.payload, result.slots, cores.c_str(),
+                        result.cores.label.c_str(), tput[0], tput[1], tput[2],
+                        rtt[0], rtt[1], rtt[2], rtt[3], l1_field);
+        }
+        std::fflush(stdout);
+        first = false;
+    }
+};
+
+/* Publishes what a queue with a batching producer still holds back,
+ * a no-op for queues without flushProducer(). */
+template<typename Queue>
+inline auto
+flushPushes(Queue& q, int) -> decltype(q.flushProducer()) {
+    q.flushProducer();
+}
+
+template<typename Queue>
+inline void
+flushPushes(Queue&, long) {}
+
+/* Pops the next item of q, polling tryPop() when it has no blocking
+ * pop(), as with Traits::publish_whole_lines. */
+template<typename T, typename Queue>
+inline auto
+popItem(Queue& q, int) -> decltype(q.pop()) {
+    return q.pop();
+}
+
+template<typename T, typename Queue>
+inline T
+popItem(Queue& q, long) {
+    T value;
+    while (!q.tryPop(value)) spinLoopHint();
+    return value;
+}
+
+/* Streams iterations messages from the calling thread to a consumer
+ * thread, returns the throughput in ops/ms. Stores the L1D read misses
+ * per message of both threads in l1_misses, -1 if they can't be counted. */
+template<typename Queue, typename T>
+double
+throughputTrial(Queue& q, size_t iterations, const CorePair& cores, double* l1_misses = nullptr) {
+    uint64_t consumer_misses = 0;
+    bool consumer_counted = false;
+    std::thread consumer_thread([&] {
+        pinToCore(cores.consumer);
+        L1MissCounter const counter;
+        uint64_t const before = counter.read();
+        for (size_t i = 0; i < iterations; ++i) {
+            T const value = popItem<T>(q, 0);
+            if (value.words[0] != i) std::abort();
+        }
+        consumer_misses = counter.read() - before;
+        consumer_counted = counter.valid();
+    });
+
+    pinToCore(cores.producer);
+    L1MissCounter const counter;
+    uint64_t const before = counter.read();
+    auto const start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        T value;
+        value.words[0] = i;
+        q.push(value);
+    }
+    flushPushes(q, 0);
+    uint64_t const producer_misses = counter.read() - before;
+    consumer_thread.join();
+    auto const end = std::chrono::steady_clock::now();
+
+    if (l1_misses != nullptr) {
+        *l1_misses = counter.valid() && consumer_counted && iterations != 0
+            ? static_cast<double>(producer_misses + consumer_misses) / static_cast<double>(iterations)
+            : -1;
+    }
+
+    auto const elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    return static_cast<double>(iterations) * 1e6 / static_cast<double>(elapsed_ns);
+}
+
+/* Ping-pongs iterations messages through two queues, recording every
+ * round trip in ticks into rtt. Returns the mean round trip in ns. */
+template<typename Queue, typename T>
+double
+rttTrial(Queue& ping, Queue& pong, size_t iterations, const CorePair& cores, Histogram* rtt) {
+    std::thread consumer_thread([&] {
+        pinToCore(cores.consumer);
+        for (size_t i = 0; i < iterations; ++i) pong.push(popItem<T>(ping, 0));
+    });
+
+    pinToCore(cores.producer);
+    auto const start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        T value;
+        value.words[0] = i;
+        uint64_t const sent = readTsc();
+        ping.push(value);
+        T const echo = popItem<T>(pong, 0);
+        uint64_t const received = readTscp();
+        if (echo.words[0] != i) std::abort();
+        if (rtt != nullptr) rtt->record(received - sent);
+    }
+    auto const end = std::chrono::steady_clock::now();
+    consumer_thread.join();
+
+    auto const elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    return static_cast<double>(elapsed_ns) / static_cast<double>(iterations);
+}
+
+template<template<typename> class Queue, typename T>
+void
+runConfiguration(const std::string& name, const BenchConfig& config, size_t slots,
+                 const CorePair& cores, Reporter& reporter) {
+    if (slots == 0) slots = recommendedSlots<T>();
+
+    BenchResult result{name, sizeof(T), slots, cores, {}, {}, {}, 0};
+    if (config.throughput) {
+        {
+            Queue<T> warm(slots);
+            (void)throughputTrial<Queue<T>, T>(warm, config.warmup, cores);
+        }
+        for (size_t trial = 0; trial < config.trials; ++trial) {
+            Queue<T> q(slots);
+            double misses;
+            result.throughput.push_back(throughputTrial<Queue<T>, T>(q, config.iterations, cores, &misses));
+            if (misses >= 0) result.l1_misses.push_back(misses);
+        }
+    }
+    if (config.rtt) {
+        Queue<T> ping(slots), pong(slots);
+        (void)rttTrial<Queue<T>, T>(ping, pong, config.warmup, cores, nullptr);
+        double mean = 0;
+        for (size_t trial = 0; trial < config.trials; ++trial) {
+            mean += rttTrial<Queue<T>, T>(ping, pong, config.iterations, cores, &result.rtt);
+        }
+        result.rtt_mean_ns = config.trials ? mean / config.trials : 0;
+    }
+    reporter.add(std::move(result));
+}
+
+template<template<typename> class Queue, size_t... Sizes>
+void
+runPayloads(const std::string& name, const BenchConfig& config, size_t bytes, size_t slots,
+            const CorePair& cores, Reporter& reporter, std::index_sequence<Sizes...>) {
+    ((bytes == payload_sizes[Sizes]
+          ? runConfiguration<Queue, Payload<payload_sizes[Sizes]>>(name, config, slots, cores, reporter)
+          : void()), ...);
+}
+
+/* Runs every configured core pair, payload and capacity for Queue. */
+template<template<typename> class Queue>
+void
+runQueue(const std::string& name, const BenchConfig& config, Reporter& reporter) {
+    constexpr size_t sizes = sizeof(payload_sizes) / sizeof(payload_sizes[0]);
+    for (const CorePair& cores : config.cores) {
+        for (size_t bytes : config.payloads) {
+            for (size_t slots : config.slots) {
+                runPayloads<Queue>(name, config, bytes, slots, cores, reporter, std::make_index_sequence<sizes>{});
+            }
+        }
+    }
+}
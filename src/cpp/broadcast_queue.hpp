@@ -0,0 +1,235 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) Andrea Vaccaro
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Source: https://github.com/ANDRVV/SPSCQueue
+ * A single-producer ring every consumer reads in full (broadcast, SPMC).
+ */
+
+#pragma once
+
+#include <memory>
+
+#include "queue.hpp"
+
+/* Every item pushed is seen by each of the reader_count consumers, which
+ * read it in place at their own pace through their own cursor. The producer
+ * only holds back for the slowest reader; it caches that reader's position
+ * and rescans the cursors only when the ring looks full against the cache.
+ * Cursors are monotonic, so the whole ring is usable.
+ *
+ * Items every reader has passed are destroyed by the producer when it next
+ * rescans the cursors, or with the queue. Traits::ConsumerWait is shared
+ * by all readers. */
+template<typename T, typename Traits = DefaultQueueTraits>
+class alignas(CACHE_LINE) BroadcastQueue {
+    static_assert(std::is_nothrow_destructible<T>::value,
+                  "T must be nothrow destructible");
+    static_assert(std::is_copy_constructible<T>::value,
+                  "T must be copyable, every reader gets a copy or a const reference");
+
+private:
+    /* a reader's published cursor and its private producer cursor cache */
+    struct ReaderCursor {
+        alignas(CACHE_LINE) std::atomic<size_t> cursor{0};
+        alignas(CACHE_LINE) size_t pop_cursor_cache = 0;
+    };
+
+    SlotStorage<T, dynamic_slots> storage;
+    std::unique_ptr<ReaderCursor[]> readers;
+    size_t const reader_count;
+
+    alignas(CACHE_LINE) std::atomic<size_t> producer{0};
+    typename Traits::ConsumerWait consumer_wait;
+
+    /* producer private: lowest reader cursor seen and whose it was */
+    alignas(CACHE_LINE) size_t slowest_cache = 0;
+    size_t slowest_reader = 0;
+    alignas(CACHE_LINE) typename Traits::ProducerWait producer_wait;
+
+    inline __attribute__((always_inline)) size_t
+    capacity() const noexcept {
+        return storage.mask + 1;
+    }
+
+    inline __attribute__((always_inline)) T*
+    items() noexcept {
+        return storage.items();
+    }
+
+    inline void
+    refreshSlowest() noexcept {
+        size_t slowest = 0;
+        size_t lowest = readers[0].cursor.load(std::memory_order_acquire);
+        for (size_t r = 1; r < reader_count; ++r) {
+            size_t const position = readers[r].cursor.load(std::memory_order_acquire);
+            if (position - lowest > capacity()) { /* position < lowest, in modular order */
+                lowest = position;
+                slowest = r;
+            }
+        }
+        for (size_t i = slowest_cache; i != lowest; ++i) items()[i & storage.mask].~T();
+        slowest_cache = lowest;
+        slowest_reader = slowest;
+    }
+
+    inline __attribute__((always_inline)) bool
+    refreshPopCache(ReaderCursor& reader, size_t index) noexcept {
+        reader.pop_cursor_cache = producer.load(std::memory_order_acquire);
+        return index != reader.pop_cursor_cache;
+    }
+
+    template<typename... Args> inline __attribute__((always_inline)) void
+    construct(size_t index, Args&&... args) {
+        ::new (static_cast<void*>(items() + (index & storage.mask))) T(std::forward<Args>(args)...);
+    }
+
+    inline __attribute__((always_inline)) void
+    publish(size_t index) noexcept {
+        producer.store(index, std::memory_order_release);
+        consumer_wait.notify(producer);
+    }
+
+public:
+    explicit BroadcastQueue(size_t reader_count_, size_t slots_, const SlotAllocation& alloc = {})
+        : storage(slots_, alloc), readers(new ReaderCursor[reader_count_]), reader_count(reader_count_) {
+        assert(reader_count_ != 0);
+    }
+
+    ~BroadcastQueue() {
+        size_t const write_index = producer.load(std::memory_order_acquire);
+        for (size_t i = slowest_cache; i != write_index; ++i) items()[i & storage.mask].~T();
+    }
+
+    BroadcastQueue(const BroadcastQueue&) = delete;
+    BroadcastQueue& operator=(const BroadcastQueue&) = delete;
+
+    template<typename... Args> inline void
+    emplace(Args&&... args) {
+        size_t const index = producer.load(std::memory_order_relaxed);
+
+        if (index - slowest_cache == capacity()) {
+            refreshSlowest();
+            for (unsigned round = 0; index - slowest_cache == capacity(); ++round) {
+                producer_wait.wait(readers[slowest_reader].cursor, slowest_cache, round);
+                refreshSlowest();
+            }
+        }
+
+        construct(index, std::forward<Args>(args)...);
+        publish(index + 1);
+    }
+
+    template<typename... Args> [[nodiscard]] inline bool
+    tryEmplace(Args&&... args) {
+        size_t const index = producer.load(std::memory_order_relaxed);
+
+        if (index - slowest_cache == capacity()) {
+            refreshSlowest();
+            if (index - slowest_cache == capacity()) return false;
+        }
+
+        construct(index, std::forward<Args>(args)...);
+        publish(index + 1);
+        return true;
+    }
+
+    inline void
+    push(const T& value) {
+        emplace(value);
+    }
+
+    inline void
+    push(T&& value) {
+        emplace(std::move(value));
+    }
+
+    [[nodiscard]] inline bool
+    tryPush(const T& value) {
+        return tryEmplace(value);
+    }
+
+    [[nodiscard]] inline bool
+    tryPush(T&& value) {
+        return tryEmplace(std::move(value));
+    }
+
+    /* Returns reader's next item in place, or nullptr if it has read
+     * everything. Release it with popFront(reader). */
+    [[nodiscard]] inline const T*
+    front(size_t reader) noexcept {
+        ReaderCursor& r = readers[reader];
+        size_t const index = r.cursor.load(std::memory_order_relaxed);
+        if (index == r.pop_cursor_cache && !refreshPopCache(r, index)) return nullptr;
+        return items() + (index & storage.mask);
+    }
+
+    inline void
+    popFront(size_t reader) noexcept {
+        ReaderCursor& r = readers[reader];
+        size_t const index = r.cursor.load(std::memory_order_relaxed) + 1;
+        r.cursor.store(index, std::memory_order_release);
+        producer_wait.notify(r.cursor);
+    }
+
+    [[nodiscard]] inline bool
+    tryPop(size_t reader, T& out) {
+        const T* item = front(reader);
+        if (item == nullptr) return false;
+        out = *item;
+        popFront(reader);
+        return true;
+    }
+
+    [[nodiscard]] inline T
+    pop(size_t reader) {
+        ReaderCursor& r = readers[reader];
+        size_t const index = r.cursor.load(std::memory_order_relaxed);
+        if (index == r.pop_cursor_cache && !refreshPopCache(r, index)) {
+            for (unsigned round = 0; !refreshPopCache(r, index); ++round) {
+                consumer_wait.wait(producer, r.pop_cursor_cache, round);
+            }
+        }
+
+        T value = items()[index & storage.mask];
+        popFront(reader);
+        return value;
+    }
+
+    [[nodiscard]] inline size_t
+    readerCount() const noexcept {
+        return reader_count;
+    }
+
+    /* Items reader has not read yet. */
+    [[nodiscard]] inline size_t
+    count(size_t reader) const noexcept {
+        size_t const read_index = readers[reader].cursor.load(std::memory_order_acquire);
+        size_t const write_index = producer.load(std::memory_order_acquire);
+        return write_index - read_index;
+    }
+
+    [[nodiscard]] inline bool
+    isEmpty(size_t reader) const noexcept {
+        return count(reader) == 0;
+    }
+};
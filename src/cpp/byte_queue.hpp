@@ -0,0 +1,207 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) Andrea Vaccaro
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Source: https://github.com/ANDRVV/SPSCQueue
+ * A single-producer, single-consumer ring of variable-length records.
+ */
+
+#pragma once
+
+#include <cstring>
+
+#include "queue.hpp"
+
+/* Byte ring storing length-prefixed records contiguously. Each record is
+ * an 8 byte header holding the payload length followed by the payload,
+ * padded to 8 bytes. A record never wraps: when it does not fit before
+ * the end of the buffer the producer fills the tail with a padding record
+ * the consumer skips. Cursors are byte offsets that only grow, masked on
+ * access, so the whole buffer is usable. */
+class alignas(CACHE_LINE) SPSCByteQueue {
+private:
+    using Header = uint64_t;
+    static constexpr size_t header_size = sizeof(Header);
+    static constexpr Header padding_record = ~Header{0};
+
+    SlotStorage<Header, dynamic_slots> storage;
+
+    alignas(CACHE_LINE) std::atomic<size_t> producer{0};
+    alignas(CACHE_LINE) std::atomic<size_t> consumer{0};
+
+    /* producer private: consumer cursor cache and the pending reservation */
+    alignas(CACHE_LINE) size_t push_cursor_cache = 0;
+    size_t reserved_at = 0; /* cursor of the reserved record header */
+    size_t reserved_length = 0;
+
+    /* consumer private: producer cursor cache and the peeked record end */
+    alignas(CACHE_LINE) size_t pop_cursor_cache = 0;
+    size_t peeked_end = 0;
+
+    static inline __attribute__((always_inline)) size_t
+    recordSize(size_t length) noexcept {
+        return header_size + ((length + header_size - 1) & ~(header_size - 1));
+    }
+
+    inline __attribute__((always_inline)) size_t
+    capacityBytes() const noexcept {
+        return (storage.mask + 1) * header_size;
+    }
+
+    inline __attribute__((always_inline)) unsigned char*
+    bytes() noexcept {
+        return reinterpret_cast<unsigned char*>(storage.items());
+    }
+
+    inline __attribute__((always_inline)) Header&
+    headerAt(size_t cursor) noexcept {
+        return storage.items()[(cursor / header_size) & storage.mask];
+    }
+
+public:
+    /* capacity_bytes must be a power of two, at least 16 */
+    explicit SPSCByteQueue(size_t capacity_bytes, const SlotAllocation& alloc = {})
+        : storage(capacity_bytes / header_size, alloc) {
+        assert((capacity_bytes & (capacity_bytes - 1)) == 0 && capacity_bytes >= 2 * header_size);
+    }
+
+    SPSCByteQueue(const SPSCByteQueue&) = delete;
+    SPSCByteQueue& operator=(const SPSCByteQueue&) = delete;
+
+    /* Largest payload reserve() accepts: half the ring minus a header,
+     * so a record plus the padding before it always fits in an empty ring. */
+    [[nodiscard]] inline size_t
+    maxMessageSize() const noexcept {
+        return capacityBytes() / 2 - header_size;
+    }
+
+    /* Returns contiguous, 8-byte aligned storage for a length bytes payload,
+     * empty if the ring has no room for it yet. Fill it and publish it with
+     * commit(); reserving again before committing drops the reservation. */
+    [[nodiscard]] inline SlotSpan<unsigned char>
+    reserve(size_t length) noexcept {
+        assert(length <= maxMessageSize());
+        size_t const index = producer.load(std::memory_order_relaxed);
+        size_t const offset = index & (capacityBytes() - 1);
+        size_t const tail = capacityBytes() - offset;
+        size_t const size = recordSize(length);
+
+        /* wrapping burns the rest of the buffer as padding */
+        size_t const at = size <= tail ? index : index + tail;
+        size_t const needed = at + size - index;
+
+        if (index + needed - push_cursor_cache > capacityBytes()) {
+            push_cursor_cache = consumer.load(std::memory_order_acquire);
+            if (index + needed - push_cursor_cache > capacityBytes()) return {};
+        }
+
+        reserved_at = at;
+        reserved_length = length;
+        return {bytes() + (at & (capacityBytes() - 1)) + header_size, length};
+    }
+
+    /* Publishes the record returned by the last reserve(). */
+    inline void
+    commit() noexcept {
+        commit(reserved_length);
+    }
+
+    /* Publishes the last reservation shrunk to length <= the reserved length. */
+    inline void
+    commit(size_t length) noexcept {
+        assert(length <= reserved_length);
+        size_t const index = producer.load(std::memory_order_relaxed);
+        if (reserved_at != index) headerAt(index) = padding_record;
+        headerAt(reserved_at) = length;
+        producer.store(reserved_at + recordSize(length), std::memory_order_release);
+    }
+
+    /* Copies length bytes in as one record, returns false if there is no room. */
+    [[nodiscard]] inline bool
+    tryPush(const void* data, size_t length) noexcept {
+        SlotSpan<unsigned char> const record = reserve(length);
+        if (record.data() == nullptr) return false;
+        std::memcpy(record.data(), data, length);
+        commit();
+        return true;
+    }
+
+    /* Returns the payload of the oldest record without removing it, empty
+     * (with a null data()) if the ring is empty. Release it with release(). */
+    [[nodiscard]] inline SlotSpan<const unsigned char>
+    peek() noexcept {
+        size_t index = consumer.load(std::memory_order_relaxed);
+        if (index == pop_cursor_cache) {
+            pop_cursor_cache = producer.load(std::memory_order_acquire);
+            if (index == pop_cursor_cache) return {};
+        }
+
+        Header length = headerAt(index);
+        if (length == padding_record) {
+            /* a padding record is always published with the record after it */
+            index += capacityBytes() - (index & (capacityBytes() - 1));
+            length = headerAt(index);
+        }
+
+        peeked_end = index + recordSize(length);
+        return {bytes() + (index & (capacityBytes() - 1)) + header_size, length};
+    }
+
+    /* Releases the record returned by the last peek(). */
+    inline void
+    release() noexcept {
+        consumer.store(peeked_end, std::memory_order_release);
+    }
+
+    /* Copies the oldest record out if it fits in max bytes and stores its
+     * length. Returns false if the ring is empty (length is 0) or dst is
+     * too small (length is the record size and the record stays queued). */
+    [[nodiscard]] inline bool
+    tryPop(void* dst, size_t max, size_t& length) noexcept {
+        SlotSpan<const unsigned char> const record = peek();
+        length = record.size();
+        if (record.data() == nullptr || record.size() > max) return false;
+        std::memcpy(dst, record.data(), record.size());
+        release();
+        return true;
+    }
+
+    [[nodiscard]] inline size_t
+    capacity() const noexcept {
+        return capacityBytes();
+    }
+
+    /* Bytes in use, headers and padding included. */
+    [[nodiscard]] inline size_t
+    countBytes() const noexcept {
+        size_t const read_index = consumer.load(std::memory_order_acquire);
+        size_t const write_index = producer.load(std::memory_order_acquire);
+        return write_index - read_index;
+    }
+
+    [[nodiscard]] inline bool
+    isEmpty() const noexcept {
+        size_t const write_index = producer.load(std::memory_order_acquire);
+        size_t const read_index = consumer.load(std::memory_order_acquire);
+        return write_index == read_index;
+    }
+};
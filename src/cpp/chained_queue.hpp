@@ -0,0 +1,194 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) Andrea Vaccaro
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Source: https://github.com/ANDRVV/SPSCQueue
+ * A growable single-producer, single-consumer queue chaining fixed-size rings.
+ */
+
+#pragma once
+
+#include "queue.hpp"
+
+/* Unbounded queue made of fixed-size SPSCQueue segments linked in a list.
+ * The producer pushes to the tail segment and, when it is full, links a
+ * fresh one and moves on; the consumer pops from the head segment and,
+ * once it is drained and linked to a successor, hands it back through a
+ * small pool the producer draws from before allocating. A queue that fits
+ * its segment stays on it, at the cost of a plain SPSCQueue plus one
+ * branch, and reaches for the next-segment link only when it is empty.
+ *
+ * Only the try side of each ring is used: push() never waits and pop()
+ * spins. The segment's wait strategies are therefore unused. */
+template<typename T, typename Traits = DefaultQueueTraits>
+class ChainedSPSCQueue {
+private:
+    struct Segment {
+        SPSCQueue<T, dynamic_slots, Traits> ring;
+        /* written once by the producer when it leaves the segment */
+        alignas(CACHE_LINE) std::atomic<Segment*> next{nullptr};
+
+        Segment(size_t slots, const SlotAllocation& alloc) : ring(slots, alloc) {}
+    };
+
+    /* drained segments travel back from the consumer to the producer */
+    static constexpr size_t pool_slots = 4;
+
+    size_t const segment_slots;
+    SlotAllocation const allocation;
+    StaticSPSCQueue<Segment*, pool_slots> pool;
+
+    /* producer private */
+    alignas(CACHE_LINE) Segment* tail;
+    /* consumer private */
+    alignas(CACHE_LINE) Segment* head;
+
+    inline Segment*
+    takeSegment() {
+        Segment* segment;
+        if (pool.tryPop(segment)) return segment;
+        return new Segment(segment_slots, allocation);
+    }
+
+    /* moves the producer to a new segment, linked
+     * after everything pushed to the old one is published */
+    inline void
+    grow() {
+        Segment* const next = takeSegment();
+        tail->ring.flushProducer();
+        tail->next.store(next, std::memory_order_release);
+        tail = next;
+    }
+
+    /* hands the drained head segment back, from the consumer */
+    inline void
+    retire(Segment* segment) noexcept {
+        segment->ring.flushConsumer();
+        segment->next.store(nullptr, std::memory_order_relaxed);
+        if (!pool.tryPush(segment)) delete segment;
+    }
+
+public:
+    /* slots per segment must be a power of two >= 2 */
+    explicit ChainedSPSCQueue(size_t segment_slots_ = recommendedSlots<T>(), const SlotAllocation& alloc = {})
+        : segment_slots(segment_slots_), allocation(alloc) {
+        tail = head = new Segment(segment_slots, allocation);
+    }
+
+    ~ChainedSPSCQueue() {
+        for (Segment* segment = head; segment != nullptr;) {
+            Segment* const next = segment->next.load(std::memory_order_acquire);
+            delete segment;
+            segment = next;
+        }
+        Segment* segment;
+        while (pool.tryPop(segment)) delete segment;
+    }
+
+    ChainedSPSCQueue(const ChainedSPSCQueue&) = delete;
+    ChainedSPSCQueue& operator=(const ChainedSPSCQueue&) = delete;
+
+    /* Never waits; allocates a segment when the tail one is full and the pool is empty. */
+    template<typename... Args> inline void
+    emplace(Args&&... args) {
+        if (__builtin_expect(tail->ring.tryEmplace(std::forward<Args>(args)...), 1)) return;
+        grow();
+        /* the new segment is empty, this can't fail */
+        bool const pushed = tail->ring.tryEmplace(std::forward<Args>(args)...);
+        assert(pushed);
+        (void)pushed;
+    }
+
+    inline void
+    push(const T& value) {
+        emplace(value);
+    }
+
+    inline void
+    push(T&& value) {
+        emplace(std::move(value));
+    }
+
+    /* Producer side: publishes pushes held back by Traits::producer_batch. */
+    inline void
+    flushProducer() noexcept {
+        tail->ring.flushProducer();
+    }
+
+    [[nodiscard]] inline bool
+    tryPop(T& out) {
+        for (;;) {
+            if (__builtin_expect(head->ring.tryPop(out), 1)) return true;
+            Segment* const next = head->next.load(std::memory_order_acquire);
+            if (next == nullptr) return false;
+            /* the last items of the segment are visible now */
+            if (head->ring.tryPop(out)) return true;
+            Segment* const drained = head;
+            head = next;
+            retire(drained);
+        }
+    }
+
+    [[nodiscard]] inline T
+    pop() {
+        for (;;) {
+            if (T* item = frontMutable()) {
+                T value = std::move(*item);
+                popFront();
+                return value;
+            }
+            spinLoopHint();
+        }
+    }
+
+    /* Returns the oldest item in place, or nullptr if the queue
+     * is empty. Release it with popFront(). */
+    [[nodiscard]] inline const T*
+    front() {
+        return frontMutable();
+    }
+
+    /* front() for a consumer that moves the item out before popFront(). */
+    [[nodiscard]] inline T*
+    frontMutable() {
+        for (;;) {
+            if (T* item = head->ring.frontMutable()) return item;
+            Segment* const next = head->next.load(std::memory_order_acquire);
+            if (next == nullptr) return nullptr;
+            if (T* item = head->ring.frontMutable()) return item;
+            Segment* const drained = head;
+            head = next;
+            retire(drained);
+        }
+    }
+
+    /* Destroys and releases the item returned by front(). */
+    inline void
+    popFront() {
+        head->ring.popFront();
+    }
+
+    [[nodiscard]] inline size_t
+    segmentSlots() const noexcept {
+        return segment_slots;
+    }
+};
@@ -0,0 +1,178 @@
+/*
+ * Head-to-head benchmark: every queue runs through the same harness
+ * (pinning, warmup, trials, histograms) from benchmark.hpp.
+ *
+ * Competitors are picked up when their headers are on the include path:
+ *   rigtorp  <rigtorp/SPSCQueue.h>
+ *   boost    <boost/lockfree/spsc_queue.hpp>
+ *   folly    <folly/ProducerConsumerQueue.h>  (link -lfolly)
+ * The Zig port is linked through its C ABI (src/zig/capi.zig) when
+ * SPSC_BENCH_ZIG is defined.
+ *
+ * --queue NAME[,NAME...] restricts the run, e.g. --queue SPSCQueue,rigtorp
+ */
+
+#include "benchmark.hpp"
+
+#if __has_include(<rigtorp/SPSCQueue.h>)
+    #include <rigtorp/SPSCQueue.h>
+    #define SPSC_BENCH_RIGTORP
+#endif
+
+#if __has_include(<boost/lockfree/spsc_queue.hpp>)
+    #include <boost/lockfree/spsc_queue.hpp>
+    #define SPSC_BENCH_BOOST
+#endif
+
+#if __has_include(<folly/ProducerConsumerQueue.h>)
+    #include <folly/ProducerConsumerQueue.h>
+    #define SPSC_BENCH_FOLLY
+#endif
+
+template<typename T>
+using DefaultQueue = SPSCQueue<T>;
+
+#ifdef SPSC_BENCH_ZIG
+    #define SPSC_ZIG_DECLARE(bytes)                                  \
+        extern "C" void* spsc_zig_create_##bytes(size_t slots);      \
+        extern "C" void spsc_zig_destroy_##bytes(void* queue);       \
+        extern "C" void spsc_zig_push_##bytes(void* queue, const void* value); \
+        extern "C" void spsc_zig_pop_##bytes(void* queue, void* value);        \
+        template<> struct ZigApi<bytes> {                            \
+            static void* create(size_t slots) { return spsc_zig_create_##bytes(slots); } \
+            static void destroy(void* q) { spsc_zig_destroy_##bytes(q); }               \
+            static void push(void* q, const void* v) { spsc_zig_push_##bytes(q, v); }   \
+            static void pop(void* q, void* v) { spsc_zig_pop_##bytes(q, v); }           \
+        };
+
+template<size_t Bytes>
+struct ZigApi;
+
+SPSC_ZIG_DECLARE(8)
+SPSC_ZIG_DECLARE(16)
+SPSC_ZIG_DECLARE(32)
+SPSC_ZIG_DECLARE(64)
+SPSC_ZIG_DECLARE(128)
+SPSC_ZIG_DECLARE(256)
+SPSC_ZIG_DECLARE(512)
+SPSC_ZIG_DECLARE(1024)
+
+/* The call through the C ABI is not inlined, which the Zig numbers include. */
+template<typename T>
+class ZigQueue {
+private:
+    using Api = ZigApi<sizeof(T)>;
+    void* handle;
+
+public:
+    explicit ZigQueue(size_t slots) : handle(Api::create(slots)) {
+        if (handle == nullptr) throw std::bad_alloc();
+    }
+    ~ZigQueue() { Api::destroy(handle); }
+    ZigQueue(const ZigQueue&) = delete;
+    ZigQueue& operator=(const ZigQueue&) = delete;
+
+    inline void push(const T& value) { Api::push(handle, &value); }
+    inline T pop() { T value; Api::pop(handle, &value); return value; }
+};
+#endif
+
+#ifdef SPSC_BENCH_RIGTORP
+template<typename T>
+class RigtorpQueue {
+private:
+    rigtorp::SPSCQueue<T> q;
+
+public:
+    /* rigtorp takes the usable capacity and adds its slack slot itself;
+     * SPSCQueue uses all of its slots, so both hold slots items */
+    explicit RigtorpQueue(size_t slots) : q(slots) {}
+
+    inline void push(const T& value) { q.push(value); }
+
+    inline T
+    pop() {
+        T* front;
+        while ((front = q.front()) == nullptr) spinLoopHint();
+        T const value = *front;
+        q.pop();
+        return value;
+    }
+};
+#endif
+
+#ifdef SPSC_BENCH_BOOST
+template<typename T>
+class BoostQueue {
+private:
+    boost::lockfree::spsc_queue<T> q;
+
+public:
+    /* takes the usable capacity, like rigtorp */
+    explicit BoostQueue(size_t slots) : q(slots) {}
+
+    inline void push(const T& value) { while (!q.push(value)) {} }
+
+    inline T
+    pop() {
+        T value;
+        while (!q.pop(value)) spinLoopHint();
+        return value;
+    }
+};
+#endif
+
+#ifdef SPSC_BENCH_FOLLY
+template<typename T>
+class FollyQueue {
+private:
+    folly::ProducerConsumerQueue<T> q;
+
+public:
+    /* folly takes the ring size and keeps one slot empty, one more gives slots usable */
+    explicit FollyQueue(size_t slots) : q(static_cast<uint32_t>(slots + 1)) {}
+
+    inline void push(const T& value) { while (!q.write(value)) {} }
+
+    inline T
+    pop() {
+        T value;
+        while (!q.read(value)) spinLoopHint();
+        return value;
+    }
+};
+#endif
+
+int main(int argc, char** argv) {
+    std::vector<std::string> selected;
+    BenchConfig const config = parseArgs(argc, argv, [&](int argc_left, char** args) {
+        if (std::string(args[0]) != "--queue" || argc_left < 2) return 0;
+        for (const char* p = args[1]; *p != '\0';) {
+            const char* end = std::strchr(p, ',');
+            selected.emplace_back(p, end ? end - p : std::strlen(p));
+            p = end ? end + 1 : p + std::strlen(p);
+        }
+        return 2;
+    });
+    auto enabled = [&](const char* name) {
+        return selected.empty() || std::find(selected.begin(), selected.end(), name) != selected.end();
+    };
+
+    Reporter reporter(config.format);
+
+    if (enabled("SPSCQueue")) runQueue<DefaultQueue>("SPSCQueue", config, reporter);
+#ifdef SPSC_BENCH_ZIG
+    if (enabled("zig")) runQueue<ZigQueue>("zig", config, reporter);
+#endif
+#ifdef SPSC_BENCH_RIGTORP
+    if (enabled("rigtorp")) runQueue<RigtorpQueue>("rigtorp", config, reporter);
+#endif
+#ifdef SPSC_BENCH_BOOST
+    if (enabled("boost")) runQueue<BoostQueue>("boost", config, reporter);
+#endif
+#ifdef SPSC_BENCH_FOLLY
+    if (enabled("folly")) runQueue<FollyQueue>("folly", config, reporter);
+#endif
+
+    return 0;
+}
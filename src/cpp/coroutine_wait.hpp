@@ -0,0 +1,224 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) Andrea Vaccaro
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Source: https://github.com/ANDRVV/SPSCQueue
+ * Wait strategy suspending a C++20 coroutine until the other side publishes.
+ */
+
+#pragma once
+
+#if !defined(__cpp_impl_coroutine)
+    #error "coroutine_wait.hpp needs C++20 coroutines"
+#endif
+
+#include <coroutine>
+
+#include "queue.hpp"
+
+/* Resume policies: CoroutineWait calls them from inside the other side's
+ * push() or pop(), on whatever thread that side runs. */
+
+/* Posts a woken coroutine to an executor with post(context, handle), which
+ * should only queue it: the waking push() or pop() waits for post to
+ * return. Bind it through resumer() before the first await; waking a
+ * coroutine with no executor bound is a bug, caught by an assert. */
+class ExecutorResume {
+private:
+    void* context = nullptr;
+    void (*post)(void*, std::coroutine_handle<>) = nullptr;
+
+public:
+    inline void
+    bind(void* context_, void (*post_)(void*, std::coroutine_handle<>)) noexcept {
+        context = context_;
+        post = post_;
+    }
+
+    inline void
+    operator()(std::coroutine_handle<> handle) const {
+        assert(post != nullptr && "bind an executor to CoroutineWait::resumer() first");
+        post(context, handle);
+    }
+};
+
+/* Resumes a woken coroutine on the spot, nested inside the other side's
+ * push() or pop(): that call doesn't return until the woken coroutine
+ * suspends again or finishes, so the waking thread runs the other side's
+ * code, and a producer resumed this way runs on the consumer's thread.
+ * Coroutines waking each other nest once per coroutine in the chain (a
+ * running coroutine is never parked, so two coroutines ping-ponging stay
+ * two deep), but every frame of the chain is on the waking thread's
+ * stack. For tests and pipelines on a single thread, not for executors. */
+struct InlineResume {
+    inline void
+    operator()(std::coroutine_handle<> handle) const {
+        handle.resume();
+    }
+};
+
+/* Wait strategy for a side driven by coroutines: SPSCQueue::popAsync(),
+ * receiveAsync() and pushAsync() return the awaiters below, which complete
+ * in place when the queue allows it and otherwise park the coroutine as the
+ * side's single waiting handle. The other side's next publish takes the
+ * handle and passes it to Resume, by default an ExecutorResume that must be
+ * bound to the executor the coroutine belongs to. Parking and waking
+ * use the same fence pairing as Park, and a publish with no coroutine
+ * parked costs one fence and a load. Nothing is allocated per await.
+ *
+ * Blocking and timed operations on the side spin as with PauseSpin. As
+ * with pop(), a consumer coroutine waits for items held back by
+ * Traits::producer_batch until the producer flushes them. */
+template<typename Resume = ExecutorResume>
+class CoroutineWait {
+private:
+    std::atomic<void*> waiting{nullptr};
+    Resume resume;
+
+public:
+    /* The policy waking parked coroutines, e.g. to bind an ExecutorResume. */
+    [[nodiscard]] inline Resume&
+    resumer() noexcept {
+        return resume;
+    }
+
+    inline __attribute__((always_inline)) void
+    wait(const std::atomic<size_t>&, size_t, unsigned) noexcept {
+        spinLoopHint();
+    }
+
+    template<typename Clock, typename Duration> inline __attribute__((always_inline)) void
+    waitUntil(const std::atomic<size_t>&, size_t, unsigned,
+              const std::chrono::time_point<Clock, Duration>&) noexcept {
+        spinLoopHint();
+    }
+
+    inline __attribute__((always_inline)) void
+    notify(std::atomic<size_t>&) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiting.load(std::memory_order_relaxed) != nullptr) {
+            void* const address = waiting.exchange(nullptr, std::memory_order_acquire);
+            if (address != nullptr) resume(std::coroutine_handle<>::from_address(address));
+        }
+    }
+
+    /* Parks handle, then checks blocked() again for a publish that came
+     * first. Returns true if handle stays suspended, false if it was taken
+     * back and should continue. Once handle is visible the other side may
+     * resume it elsewhere, so blocked() must not touch the coroutine frame
+     * or the side's private state, only published cursors. */
+    template<typename Blocked> inline bool
+    suspend(std::coroutine_handle<> handle, Blocked&& blocked) noexcept {
+        assert(waiting.load(std::memory_order_relaxed) == nullptr);
+        waiting.store(handle.address(), std::memory_order_release);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (blocked()) return true;
+        /* if it's already gone, the other side resumes it */
+        return waiting.exchange(nullptr, std::memory_order_relaxed) == nullptr;
+    }
+
+    template<typename Queue>
+    class PopAwaiter {
+    private:
+        Queue& queue;
+
+    public:
+        explicit PopAwaiter(Queue& queue_) noexcept : queue(queue_) {}
+
+        [[nodiscard]] inline bool
+        await_ready() {
+            return queue.front() != nullptr;
+        }
+
+        inline bool
+        await_suspend(std::coroutine_handle<> handle) {
+            /* the awaiter lives in the frame, which may be resumed before this returns */
+            Queue& q = queue;
+            q.flushConsumer();
+            return q.consumerWait().suspend(handle, [&q] { return q.isEmpty(); });
+        }
+
+        [[nodiscard]] inline auto
+        await_resume() {
+            return queue.pop();
+        }
+    };
+
+    template<typename Queue, typename T = std::remove_const_t<std::remove_pointer_t<decltype(std::declval<Queue&>().front())>>>
+    class ReceiveAwaiter {
+    private:
+        Queue& queue;
+        T& out;
+        PopStatus status = PopStatus::empty;
+
+    public:
+        ReceiveAwaiter(Queue& queue_, T& out_) noexcept : queue(queue_), out(out_) {}
+
+        [[nodiscard]] inline bool
+        await_ready() {
+            status = queue.tryReceive(out);
+            return status != PopStatus::empty;
+        }
+
+        inline bool
+        await_suspend(std::coroutine_handle<> handle) {
+            Queue& q = queue;
+            q.flushConsumer();
+            return q.consumerWait().suspend(handle, [&q] { return q.isEmpty() && !q.isClosed(); });
+        }
+
+        [[nodiscard]] inline PopStatus
+        await_resume() {
+            if (status == PopStatus::empty) status = queue.tryReceive(out);
+            return status;
+        }
+    };
+
+    template<typename Queue, typename T = std::remove_const_t<std::remove_pointer_t<decltype(std::declval<Queue&>().front())>>>
+    class PushAwaiter {
+    private:
+        Queue& queue;
+        T value;
+        bool pushed = false;
+
+    public:
+        PushAwaiter(Queue& queue_, T value_) : queue(queue_), value(std::move(value_)) {}
+
+        [[nodiscard]] inline bool
+        await_ready() {
+            pushed = queue.tryPush(std::move(value));
+            return pushed;
+        }
+
+        inline bool
+        await_suspend(std::coroutine_handle<> handle) {
+            Queue& q = queue;
+            q.flushProducer();
+            return q.producerWait().suspend(handle, [&q] { return q.count() == q.capacity(); });
+        }
+
+        inline void
+        await_resume() {
+            if (!pushed) queue.push(std::move(value));
+        }
+    };
+};
@@ -0,0 +1,121 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) Andrea Vaccaro
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Source: https://github.com/ANDRVV/SPSCQueue
+ * Eventfd consumer wait strategy for queues multiplexed in an epoll loop.
+ */
+
+#pragma once
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <system_error>
+
+#include "queue.hpp"
+
+/* Consumer wait strategy signaling an eventfd when the queue goes from
+ * empty to non-empty. The consumer registers fd() in its epoll set and,
+ * after draining, calls SPSCQueue::rearm(); the producer then writes the
+ * eventfd once on its next push instead of on every message. The fast
+ * path costs the producer one fence per push and no syscall. */
+class EventFdWait {
+private:
+    int event_fd;
+    /* starts armed, the queue is empty at construction */
+    std::atomic<uint32_t> armed{1};
+
+public:
+    EventFdWait() : event_fd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {
+        if (event_fd < 0) throw std::system_error(errno, std::generic_category(), "eventfd");
+    }
+
+    ~EventFdWait() {
+        close(event_fd);
+    }
+
+    EventFdWait(const EventFdWait&) = delete;
+    EventFdWait& operator=(const EventFdWait&) = delete;
+
+    /* Readable when the queue went non-empty after rearm(). */
+    [[nodiscard]] inline int
+    fd() const noexcept {
+        return event_fd;
+    }
+
+    /* Clears a pending notification, call it when fd() polls readable. */
+    inline void
+    acknowledge() noexcept {
+        uint64_t value;
+        (void)!read(event_fd, &value, sizeof(value));
+    }
+
+    inline void
+    arm() noexcept {
+        armed.store(1, std::memory_order_seq_cst);
+    }
+
+    inline void
+    disarm() noexcept {
+        armed.store(0, std::memory_order_relaxed);
+    }
+
+    /* Blocking pops sleep on the eventfd itself. */
+    inline void
+    wait(const std::atomic<size_t>& cursor, size_t seen, unsigned round) noexcept {
+        waitFor(cursor, seen, round, -1);
+    }
+
+    template<typename Clock, typename Duration> inline void
+    waitUntil(const std::atomic<size_t>& cursor, size_t seen, unsigned round,
+              const std::chrono::time_point<Clock, Duration>& deadline) noexcept {
+        auto const left = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - Clock::now());
+        if (left.count() > 0) waitFor(cursor, seen, round, left.count());
+    }
+
+    inline void
+    notify(std::atomic<size_t>&) noexcept {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (armed.load(std::memory_order_relaxed) != 0 && armed.exchange(0, std::memory_order_relaxed) != 0) {
+            uint64_t const one = 1;
+            (void)!write(event_fd, &one, sizeof(one));
+        }
+    }
+
+private:
+    inline void
+    waitFor(const std::atomic<size_t>& cursor, size_t seen, unsigned, int64_t timeout_ns) noexcept {
+        arm();
+        if (cursor.load(std::memory_order_seq_cst) == seen) {
+            struct pollfd pfd = {event_fd, POLLIN, 0};
+            struct timespec timeout = {static_cast<time_t>(timeout_ns / 1'000'000'000),
+                                       static_cast<long>(timeout_ns % 1'000'000'000)};
+            (void)ppoll(&pfd, 1, timeout_ns < 0 ? nullptr : &timeout, nullptr);
+            acknowledge();
+        }
+        disarm();
+    }
+};
@@ -0,0 +1,58 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) Andrea Vaccaro
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Source: https://github.com/ANDRVV/SPSCQueue
+ * Bucket math of the log-linear latency histograms.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/* Log-linear buckets in the style of HdrHistogram: values below 2^S are
+ * exact, above that every power of two is split in 2^(S-1) buckets, so the
+ * relative error stays under 2^-(S-1) (~3% with S = 6) at any magnitude.
+ * Shared by the benchmark's Histogram and TracedSPSCQueue's DwellHistogram. */
+template<unsigned S = 6>
+struct LogLinearBuckets {
+    static constexpr unsigned sub_bits = S;
+    static constexpr size_t half = size_t{1} << (sub_bits - 1);
+    static constexpr size_t count = (64 - sub_bits + 1) * half + 2 * half;
+
+    static inline __attribute__((always_inline)) size_t
+    bucketOf(uint64_t value) noexcept {
+        unsigned const msb = 63 - static_cast<unsigned>(__builtin_clzll(value | 1));
+        unsigned const shift = msb < sub_bits ? 0 : msb - sub_bits + 1;
+        return shift * half + static_cast<size_t>(value >> shift);
+    }
+
+    /* highest value falling in bucket */
+    static inline uint64_t
+    valueOf(size_t bucket) noexcept {
+        if (bucket < 2 * half) return bucket;
+        size_t const shift = bucket / half - 1;
+        uint64_t const top = bucket - shift * half;
+        return ((top + 1) << shift) - 1;
+    }
+};
@@ -0,0 +1,141 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) Andrea Vaccaro
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Source: https://github.com/ANDRVV/SPSCQueue
+ * A single-producer, single-consumer ring overwriting the oldest items when full.
+ */
+
+#pragma once
+
+#include <cstring>
+
+#include "queue.hpp"
+
+/* Lossy ring for telemetry: push() never waits, a full ring overwrites
+ * its oldest item. Each slot carries a seqlock stamp, 2 * index + 1 while
+ * item index is written and 2 * index + 2 once it is complete, so the
+ * consumer reads the slot alone, with no shared cursor at all, and tells
+ * an empty slot (older stamp) from an overrun one (newer stamp). After an
+ * overrun the consumer skips to the oldest item that can still be intact
+ * and reports how many it lost. */
+template<typename T, size_t N = dynamic_slots>
+class alignas(CACHE_LINE) LossyQueue {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "T must be trivially copyable, the consumer may copy a slot while it is rewritten");
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> sequence{0};
+        T value;
+    };
+
+    SlotStorage<Slot, N> storage;
+
+    /* producer private */
+    alignas(CACHE_LINE) uint64_t write_index = 0;
+    /* consumer private */
+    alignas(CACHE_LINE) uint64_t read_index = 0;
+    uint64_t lost_total = 0;
+
+    inline __attribute__((always_inline)) size_t
+    capacity() const noexcept {
+        return storage.mask + 1;
+    }
+
+    inline __attribute__((always_inline)) Slot&
+    slot(uint64_t index) noexcept {
+        return storage.items()[index & storage.mask];
+    }
+
+    inline void
+    initSlots() noexcept {
+        for (size_t i = 0; i < capacity(); ++i) ::new (static_cast<void*>(storage.items() + i)) Slot;
+    }
+
+public:
+    template<size_t M = N, typename = std::enable_if_t<M == dynamic_slots>>
+    explicit LossyQueue(size_t slots_, const SlotAllocation& alloc = {}) : storage(slots_, alloc) {
+        initSlots();
+    }
+
+    template<size_t M = N, typename = std::enable_if_t<M != dynamic_slots>>
+    LossyQueue() {
+        initSlots();
+    }
+
+    LossyQueue(const LossyQueue&) = delete;
+    LossyQueue& operator=(const LossyQueue&) = delete;
+
+    /* Never blocks; overwrites the oldest item when the ring is full. */
+    inline void
+    push(const T& value) noexcept {
+        Slot& s = slot(write_index);
+        s.sequence.store(2 * write_index + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(static_cast<void*>(&s.value), &value, sizeof(T));
+        s.sequence.store(2 * write_index + 2, std::memory_order_release);
+        ++write_index;
+    }
+
+    /* Copies the oldest intact item into out. Returns false if there is
+     * none yet. When items were overwritten before the consumer got to
+     * them, their number is stored in lost (0 otherwise). */
+    [[nodiscard]] inline bool
+    tryPop(T& out, uint64_t* lost = nullptr) noexcept {
+        uint64_t skipped = 0;
+        for (;;) {
+            Slot& s = slot(read_index);
+            uint64_t const expected = 2 * read_index + 2;
+            uint64_t const before = s.sequence.load(std::memory_order_acquire);
+            if (before < expected) {
+                if (lost != nullptr) *lost = skipped;
+                return false;
+            }
+
+            if (before == expected) {
+                std::memcpy(static_cast<void*>(&out), &s.value, sizeof(T));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (s.sequence.load(std::memory_order_relaxed) == expected) {
+                    ++read_index;
+                    if (lost != nullptr) *lost = skipped;
+                    return true;
+                }
+            }
+
+            /* overrun: the producer is at least at the slot's current item,
+             * skip to the oldest one it can't have started rewriting */
+            uint64_t const newest = (s.sequence.load(std::memory_order_acquire) - 1) / 2;
+            uint64_t const oldest = newest + 2 > capacity() ? newest + 2 - capacity() : 0;
+            uint64_t const next = std::max(oldest, read_index + 1);
+            skipped += next - read_index;
+            lost_total += next - read_index;
+            read_index = next;
+        }
+    }
+
+    /* Items the consumer lost to overruns so far. */
+    [[nodiscard]] inline uint64_t
+    lostCount() const noexcept {
+        return lost_total;
+    }
+};
@@ -25,10 +25,31 @@
  * A single-producer, single-consumer lock-free queue using a ring buffer.
  */
 
+#pragma once
+
+#include <algorithm>
 #include <atomic>
 #include <cassert>
-#include <vector>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
 #include <thread>
+#include <utility>
+
+#ifdef __linux__
+    #include <linux/futex.h>
+    #include <sys/mman.h>
+    #include <sys/syscall.h>
+    #include <time.h>
+    #include <unistd.h>
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64)
+    #include <immintrin.h>
+#endif
 
 #ifdef __cpp_lib_hardware_interference_size
     #define CACHE_LINE std::hardware_destructive_interference_size
@@ -51,16 +72,550 @@ spinLoopHint() noexcept {
 #endif
 }
 
-/* Returns recommended slots with alignment size of L2 cache. */
+/* Blocks while the low 32 bits of word still hold seen (may wake spuriously),
+ * at most for timeout_ns when it is not negative.
+ * The futex is not private so waits also work on process-shared queues. */
+inline void
+futexWait(const std::atomic<size_t>& word, size_t seen, int64_t timeout_ns = -1) noexcept {
+#ifdef __linux__
+    auto const* addr = reinterpret_cast<const uint32_t*>(&word);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    addr += sizeof(size_t) / sizeof(uint32_t) - 1;
+#endif
+    struct timespec timeout = {static_cast<time_t>(timeout_ns / 1'000'000'000),
+                               static_cast<long>(timeout_ns % 1'000'000'000)};
+    (void)syscall(SYS_futex, addr, FUTEX_WAIT, static_cast<uint32_t>(seen),
+                  timeout_ns < 0 ? nullptr : &timeout, nullptr, 0);
+#elif defined(__cpp_lib_atomic_wait)
+    if (timeout_ns < 0) word.wait(seen, std::memory_order_relaxed);
+    else std::this_thread::yield();
+#else
+    (void)word;
+    (void)seen;
+    (void)timeout_ns;
+    std::this_thread::yield();
+#endif
+}
+
+/* Wakes every thread blocked on word: a plain SPSCQueue has at most one,
+ * readers of a BroadcastQueue all sleep on the same producer cursor. */
+inline void
+futexWake(std::atomic<size_t>& word) noexcept {
+#ifdef __linux__
+    auto* addr = reinterpret_cast<uint32_t*>(&word);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    addr += sizeof(size_t) / sizeof(uint32_t) - 1;
+#endif
+    (void)syscall(SYS_futex, addr, FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+#elif defined(__cpp_lib_atomic_wait)
+    word.notify_all();
+#else
+    (void)word;
+#endif
+}
+
+/* Wait strategies, chosen separately for each side through the queue traits.
+ * wait() is called on every failed attempt of a blocking operation, with
+ * the other side's cursor, the value last seen in it and the number of
+ * rounds already waited; waitUntil() is the same for timed operations and
+ * must not block past the deadline; notify() is called by the other side
+ * after it moves that cursor. */
+
+/* Re-reads the cursor immediately, lowest latency, burns the core. */
+struct BusySpin {
+    inline __attribute__((always_inline)) void
+    wait(const std::atomic<size_t>&, size_t, unsigned) noexcept {}
+
+    template<typename Clock, typename Duration> inline __attribute__((always_inline)) void
+    waitUntil(const std::atomic<size_t>&, size_t, unsigned,
+              const std::chrono::time_point<Clock, Duration>&) noexcept {}
+
+    inline __attribute__((always_inline)) void
+    notify(std::atomic<size_t>&) noexcept {}
+};
+
+/* Spins with the pause hint to reduce memory bus contention. */
+struct PauseSpin {
+    inline __attribute__((always_inline)) void
+    wait(const std::atomic<size_t>&, size_t, unsigned) noexcept {
+        spinLoopHint();
+    }
+
+    template<typename Clock, typename Duration> inline __attribute__((always_inline)) void
+    waitUntil(const std::atomic<size_t>&, size_t, unsigned,
+              const std::chrono::time_point<Clock, Duration>&) noexcept {
+        spinLoopHint();
+    }
+
+    inline __attribute__((always_inline)) void
+    notify(std::atomic<size_t>&) noexcept {}
+};
+
+/* Pauses 1, 2, 4... times up to 2^SpinRounds, then yields the core. */
+template<unsigned SpinRounds = 6>
+struct Backoff {
+    inline void
+    wait(const std::atomic<size_t>&, size_t, unsigned round) noexcept {
+        if (round < SpinRounds) {
+            for (unsigned i = 0; i < (1u << round); ++i) spinLoopHint();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    template<typename Clock, typename Duration> inline void
+    waitUntil(const std::atomic<size_t>& cursor, size_t seen, unsigned round,
+              const std::chrono::time_point<Clock, Duration>&) noexcept {
+        wait(cursor, seen, round);
+    }
+
+    inline __attribute__((always_inline)) void
+    notify(std::atomic<size_t>&) noexcept {}
+};
+
+/* Pause-spins for SpinRounds rounds, then parks the thread on a futex.
+ * The notifying side pays a full fence per operation to check for a
+ * sleeper, and a syscall only when there is one. */
+template<unsigned SpinRounds = 1024>
+class Park {
+private:
+    std::atomic<uint32_t> sleepers{0};
+
+public:
+    inline void
+    wait(const std::atomic<size_t>& cursor, size_t seen, unsigned round) noexcept {
+        if (round < SpinRounds) {
+            spinLoopHint();
+            return;
+        }
+
+        sleepers.fetch_add(1, std::memory_order_seq_cst);
+        if (cursor.load(std::memory_order_seq_cst) == seen) futexWait(cursor, seen);
+        sleepers.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    template<typename Clock, typename Duration> inline void
+    waitUntil(const std::atomic<size_t>& cursor, size_t seen, unsigned round,
+              const std::chrono::time_point<Clock, Duration>& deadline) noexcept {
+        if (round < SpinRounds) {
+            spinLoopHint();
+            return;
+        }
+
+        auto const left = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - Clock::now());
+        if (left.count() <= 0) return;
+
+        sleepers.fetch_add(1, std::memory_order_seq_cst);
+        if (cursor.load(std::memory_order_seq_cst) == seen) futexWait(cursor, seen, left.count());
+        sleepers.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    inline __attribute__((always_inline)) void
+    notify(std::atomic<size_t>& cursor) noexcept {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleepers.load(std::memory_order_relaxed) != 0) futexWake(cursor);
+    }
+};
+
+/* Per-side counters reported by the QueueStats policy. */
+struct QueueSideStats {
+    uint64_t cache_refreshes = 0; /* reloads of the other side's cursor */
+    uint64_t stalls = 0; /* checks finding the ring full (producer) or empty (consumer) after a refresh */
+    uint64_t wait_rounds = 0; /* wait strategy calls of blocking and timed operations */
+    uint64_t peak_count = 0; /* highest occupancy seen at a refresh */
+};
+
+struct QueueStatsSnapshot {
+    QueueSideStats producer;
+    QueueSideStats consumer;
+};
+
+/* Stats policy compiling every counter out, the default. */
+struct NoStats {
+    inline __attribute__((always_inline)) void onRefresh(size_t) noexcept {}
+    inline __attribute__((always_inline)) void onStall() noexcept {}
+    inline __attribute__((always_inline)) void onWaitRound() noexcept {}
+
+    [[nodiscard]] inline QueueSideStats
+    snapshot() const noexcept {
+        return {};
+    }
+};
+
+/* Stats policy counting on the owning side's private cache line.
+ * Only that side writes, with plain loads and stores instead of locked
+ * read-modify-writes, so any thread can snapshot without slowing it down. */
+class QueueStats {
+private:
+    std::atomic<uint64_t> refreshes{0};
+    std::atomic<uint64_t> stalls{0};
+    std::atomic<uint64_t> rounds{0};
+    std::atomic<uint64_t> peak{0};
+
+    static inline __attribute__((always_inline)) void
+    bump(std::atomic<uint64_t>& counter) noexcept {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+public:
+    inline __attribute__((always_inline)) void
+    onRefresh(size_t occupancy) noexcept {
+        bump(refreshes);
+        if (occupancy > peak.load(std::memory_order_relaxed)) peak.store(occupancy, std::memory_order_relaxed);
+    }
+
+    inline __attribute__((always_inline)) void
+    onStall() noexcept {
+        bump(stalls);
+    }
+
+    inline __attribute__((always_inline)) void
+    onWaitRound() noexcept {
+        bump(rounds);
+    }
+
+    [[nodiscard]] inline QueueSideStats
+    snapshot() const noexcept {
+        return {refreshes.load(std::memory_order_relaxed), stalls.load(std::memory_order_relaxed),
+                rounds.load(std::memory_order_relaxed), peak.load(std::memory_order_relaxed)};
+    }
+};
+
+/* Slot layouts for Traits::Layout. */
+
+/* Items packed contiguously: the consumer learns about new items by
+ * reloading the producer cursor into its cache. */
+struct CursorLayout {
+    static constexpr bool stamped = false;
+
+    template<typename T>
+    using Slot = T;
+};
+
+/* Each slot carries a full stamp next to the item (FastForward style):
+ * the producer sets it when publishing, the consumer polls the slot it is
+ * about to read and clears it on release, so the consumer never reads the
+ * producer cursor line, only slot lines it needs anyway. A refresh scans
+ * at most ScanLimit stamps ahead. Slots aren't contiguous, so the span
+ * API (reserveWriteSpan, frontSpan) is not available. */
+template<size_t ScanLimit = 64>
+struct StampedLayout {
+    static constexpr bool stamped = true;
+    static constexpr size_t scan_limit = ScanLimit;
+
+    template<typename T>
+    struct Slot {
+        alignas(T) unsigned char value[sizeof(T)];
+        std::atomic<uint32_t> full{0};
+    };
+};
+
+/* Prefetch policies for Traits::Prefetch, distance<T> is in slots. */
+
+struct NoPrefetch {
+    template<typename T>
+    static constexpr size_t distance = 0;
+};
+
+/* The producer prefetches for writing (prefetchw with -mprfchw) the slot
+ * Bytes ahead of the one it writes, the consumer prefetches for reading the
+ * slot Bytes ahead of the one it reads. Each side only prefetches slots its
+ * cursor cache shows are its own, so it never pulls a line the other side is
+ * still using, and only once per cache line. */
+template<size_t Bytes = 2 * CACHE_LINE>
+struct PrefetchAhead {
+    template<typename T>
+    static constexpr size_t distance = (Bytes + sizeof(T) - 1) / sizeof(T);
+};
+
+/* Copies bytes with non-temporal stores where the target has them, ending
+ * with a store fence so a later release store orders them like plain ones.
+ * Other targets, aarch64 included, fall back to memcpy. */
+inline void
+streamCopy(void* dst, const void* src, size_t bytes) noexcept {
+#if defined(__x86_64__) || defined(_M_X64)
+    #if defined(__AVX512F__)
+    using Vector = __m512i;
+    #elif defined(__AVX__)
+    using Vector = __m256i;
+    #else
+    using Vector = __m128i;
+    #endif
+    auto* out = static_cast<unsigned char*>(dst);
+    auto* in = static_cast<const unsigned char*>(src);
+
+    /* plain copy up to the first vector-aligned destination byte */
+    size_t const head = std::min(bytes, (sizeof(Vector) - reinterpret_cast<uintptr_t>(out) % sizeof(Vector)) % sizeof(Vector));
+    std::memcpy(out, in, head);
+    out += head;
+    in += head;
+    bytes -= head;
+
+    for (; bytes >= sizeof(Vector); bytes -= sizeof(Vector), out += sizeof(Vector), in += sizeof(Vector)) {
+    #if defined(__AVX512F__)
+        _mm512_stream_si512(reinterpret_cast<Vector*>(out), _mm512_loadu_si512(in));
+    #elif defined(__AVX__)
+        _mm256_stream_si256(reinterpret_cast<Vector*>(out), _mm256_loadu_si256(reinterpret_cast<const Vector*>(in)));
+    #else
+        _mm_stream_si128(reinterpret_cast<Vector*>(out), _mm_loadu_si128(reinterpret_cast<const Vector*>(in)));
+    #endif
+    }
+    std::memcpy(out, in, bytes);
+    _mm_sfence();
+#else
+    std::memcpy(dst, src, bytes);
+#endif
+}
+
+/* Copy policies for Traits::Copy: how the producer's bulk operations
+ * (tryPushN, pushN) copy runs of a trivially copyable T into the ring. */
+
+struct PlainCopy {
+    static inline __attribute__((always_inline)) void
+    copy(void* dst, const void* src, size_t bytes) noexcept {
+        std::memcpy(dst, src, bytes);
+    }
+};
+
+/* Runs of at least MinBytes go through streamCopy(): they bypass the
+ * producer's caches, so pushing large frames doesn't evict its working
+ * set, and the consumer reads them from memory (or L3) instead of from
+ * the producer's L1. */
+template<size_t MinBytes = 4096>
+struct StreamingCopy {
+    static inline __attribute__((always_inline)) void
+    copy(void* dst, const void* src, size_t bytes) noexcept {
+        if (bytes < MinBytes) {
+            std::memcpy(dst, src, bytes);
+        } else {
+            streamCopy(dst, src, bytes);
+        }
+    }
+};
+
+/* Result of the close-aware pops. */
+enum class PopStatus {
+    ok,     /* an item was popped */
+    empty,  /* nothing to pop yet */
+    closed, /* the producer closed the queue and every item was popped */
+};
+
+/* Default policies. Derive from it and override members to customize a queue. */
+struct DefaultQueueTraits {
+    /* the producer busy-spins assuming the consumer is hotter than the producer,
+     * use PauseSpin here if the producer has a higher throughput */
+    using ProducerWait = BusySpin;
+    using ConsumerWait = PauseSpin;
+    using Stats = NoStats;
+    using Layout = CursorLayout;
+    /* publish the producer (consumer) cursor every this many items instead
+     * of every item; pending items are also published when the side finds
+     * the ring full (empty) and by flushProducer() (flushConsumer()) */
+    static constexpr size_t producer_batch = 1;
+    static constexpr size_t consumer_batch = 1;
+    /* publish the producer cursor only at cache line boundaries of the
+     * ring, so the consumer never reads a line the producer still writes;
+     * partial lines go out when the ring is full and by flushProducer(),
+     * and the blocking pops are unavailable since a partial line would
+     * keep them waiting for good once the producer goes idle */
+    static constexpr bool publish_whole_lines = false;
+    using Prefetch = NoPrefetch;
+    using Copy = PlainCopy;
+};
+
+/* Returns recommended slots with alignment size of L2 cache,
+ * rounded down to a power of two so it is always a valid capacity
+ * and can be used as a template argument. */
 template<typename T> [[nodiscard]] constexpr size_t
 recommendedSlots() {
     constexpr size_t sweet_spot = 4096 * CACHE_LINE;
-    size_t slots = sweet_spot / sizeof(T);
-    assert((slots & (slots - 1)) == 0 && slots >= 2);
+    static_assert(sizeof(T) <= sweet_spot / 2, "T is too large for the recommended ring size");
+    size_t slots = 2;
+    while (slots * 2 * sizeof(T) <= sweet_spot) slots *= 2;
     return slots;
 }
 
+enum class HugePages {
+    none,        /* regular allocator */
+    transparent, /* mmap + madvise(MADV_HUGEPAGE) */
+    hugetlb,     /* mmap(MAP_HUGETLB), falls back to transparent if no pages are reserved */
+};
+
+/* Placement policy of the heap slot buffer. Anything but the defaults
+ * maps the buffer directly with mmap (Linux only, ignored elsewhere). */
+struct SlotAllocation {
+    HugePages huge_pages = HugePages::none;
+    int numa_node = -1; /* mbind the buffer to this node, -1 keeps first-touch placement */
+    bool prefault = false; /* touch every page at construction, after binding */
+};
+
+/* Returns the NUMA node of the calling thread's CPU, -1 if unknown.
+ * Call it from the consumer thread to bind its ring locally. */
+[[nodiscard]] inline int
+currentNumaNode() noexcept {
+#ifdef __linux__
+    unsigned cpu = 0, node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) return static_cast<int>(node);
+#endif
+    return -1;
+}
+
+/* Capacity template argument selecting a ring sized at runtime. */
+inline constexpr size_t dynamic_slots = 0;
+
+/* Where the slots start and the mask mapping cursors to them,
+ * a constant with inline storage. */
+template<typename T, size_t N>
+struct SlotGeometry {
+    T* data;
+    static constexpr size_t mask = N - 1;
+};
+
 template<typename T>
+struct SlotGeometry<T, dynamic_slots> {
+    T* data;
+    size_t mask;
+};
+
+/* Inline slot storage with a compile-time capacity: the mask is
+ * a constant and slots are addressed relative to the queue itself. */
+template<typename T, size_t N>
+class SlotStorage {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "N must be a power of two >= 2");
+
+private:
+    alignas(T) unsigned char buffer[N * sizeof(T)];
+
+public:
+    static constexpr size_t mask = N - 1;
+
+    inline __attribute__((always_inline)) T*
+    items() noexcept {
+        return std::launder(reinterpret_cast<T*>(buffer));
+    }
+
+    inline __attribute__((always_inline)) SlotGeometry<T, N>
+    geometry() noexcept {
+        return {items()};
+    }
+};
+
+/* Heap slot storage with a capacity chosen at construction. */
+template<typename T>
+class SlotStorage<T, dynamic_slots> {
+private:
+    static constexpr std::align_val_t alignment{alignof(T) > CACHE_LINE ? alignof(T) : CACHE_LINE};
+
+    size_t mapped = 0; /* length of the mmap'ed buffer, 0 if it came from operator new */
+    T* data;
+
+#ifdef __linux__
+    static T*
+    map(size_t bytes, const SlotAllocation& alloc, size_t& mapped_) {
+        constexpr size_t huge_page = 2 * 1024 * 1024;
+        int constexpr prot = PROT_READ | PROT_WRITE;
+        int constexpr flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+        size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        void* addr = MAP_FAILED;
+        if (alloc.huge_pages == HugePages::hugetlb) {
+            mapped_ = (bytes + huge_page - 1) & ~(huge_page - 1);
+            addr = mmap(nullptr, mapped_, prot, flags | MAP_HUGETLB, -1, 0);
+            if (addr != MAP_FAILED) page = huge_page;
+        }
+        if (addr == MAP_FAILED) {
+            mapped_ = alloc.huge_pages == HugePages::none
+                ? (bytes + page - 1) & ~(page - 1)
+                : (bytes + huge_page - 1) & ~(huge_page - 1);
+            addr = mmap(nullptr, mapped_, prot, flags, -1, 0);
+            if (addr == MAP_FAILED) throw std::bad_alloc();
+            if (alloc.huge_pages != HugePages::none) {
+                (void)madvise(addr, mapped_, MADV_HUGEPAGE);
+                page = huge_page;
+            }
+        }
+
+        if (alloc.numa_node >= 0) {
+            constexpr size_t bits = 8 * sizeof(unsigned long);
+            unsigned long nodemask[1024 / bits] = {};
+            size_t const node = static_cast<size_t>(alloc.numa_node) % 1024;
+            nodemask[node / bits] = 1UL << (node % bits);
+            constexpr int mpol_bind = 2, mpol_mf_move = 1 << 1;
+            (void)syscall(SYS_mbind, addr, mapped_, mpol_bind, nodemask, 1024 + 1, mpol_mf_move);
+        }
+
+        if (alloc.prefault) {
+            volatile unsigned char* bytes_ = static_cast<unsigned char*>(addr);
+            for (size_t i = 0; i < mapped_; i += page) bytes_[i] = 0;
+        }
+        return static_cast<T*>(addr);
+    }
+#endif
+
+    static T*
+    allocate(size_t slots_, const SlotAllocation& alloc, size_t& mapped_) {
+#ifdef __linux__
+        if (alloc.huge_pages != HugePages::none || alloc.numa_node >= 0 || alloc.prefault) {
+            static_assert(alignof(T) <= 4096, "T alignment exceeds the page size");
+            return map(slots_ * sizeof(T), alloc, mapped_);
+        }
+#else
+        (void)alloc;
+        (void)mapped_;
+#endif
+        /* cache line aligned, so slot offsets tell where lines start */
+        return static_cast<T*>(::operator new(slots_ * sizeof(T), alignment));
+    }
+
+public:
+    size_t const mask;
+
+    explicit SlotStorage(size_t slots_, const SlotAllocation& alloc = {})
+        : data(allocate(slots_, alloc, mapped)), mask(slots_ - 1) {
+        assert((slots_ & (slots_ - 1)) == 0 && slots_ >= 2);
+    }
+
+    ~SlotStorage() {
+#ifdef __linux__
+        if (mapped != 0) {
+            munmap(data, mapped);
+            return;
+        }
+#endif
+        ::operator delete(data, alignment);
+    }
+
+    SlotStorage(const SlotStorage&) = delete;
+    SlotStorage& operator=(const SlotStorage&) = delete;
+
+    inline __attribute__((always_inline)) T*
+    items() noexcept {
+        return data;
+    }
+
+    inline __attribute__((always_inline)) SlotGeometry<T, dynamic_slots>
+    geometry() noexcept {
+        return {data, mask};
+    }
+};
+
+/* Contiguous run of slots inside the ring, used by the zero-copy API. */
+template<typename T>
+struct SlotSpan {
+    T* first = nullptr;
+    size_t length = 0;
+
+    [[nodiscard]] T* data() const noexcept { return first; }
+    [[nodiscard]] size_t size() const noexcept { return length; }
+    [[nodiscard]] bool empty() const noexcept { return length == 0; }
+    [[nodiscard]] T* begin() const noexcept { return first; }
+    [[nodiscard]] T* end() const noexcept { return first + length; }
+    [[nodiscard]] T& operator[](size_t i) const noexcept { return first[i]; }
+};
+
+/* Use N = dynamic_slots (the default) for a heap ring sized at construction,
+ * or a power of two N for inline storage with a constant mask. */
+template<typename T, size_t N = dynamic_slots, typename Traits = DefaultQueueTraits>
 class alignas(CACHE_LINE) SPSCQueue {
     static_assert(std::is_nothrow_destructible<T>::value,
                   "T must be nothrow destructible");
@@ -70,97 +625,847 @@ class alignas(CACHE_LINE) SPSCQueue {
         "T must be nothrow movable or copyable");
 
 private:
-    std::vector<T> items;
-    size_t mask;
+    using Layout = typename Traits::Layout;
+    using Slot = typename Layout::template Slot<T>;
+
+    static_assert(!Traits::publish_whole_lines || (!Layout::stamped && Traits::producer_batch == 1),
+                  "publish_whole_lines replaces producer_batch and needs the cursor layout");
+    static_assert(!Traits::publish_whole_lines || CACHE_LINE % sizeof(Slot) == 0 || sizeof(Slot) % CACHE_LINE == 0,
+                  "publish_whole_lines needs slots tiling cache lines");
+
+    /* With publish_whole_lines the consumer can't see a partial line until
+     * the producer flushes it, and a producer gone idle never does, so the
+     * calls waiting for an item without a deadline are not available;
+     * poll with tryPop() or the timed pops, which then return false. */
+    static constexpr bool blocking_pops = !Traits::publish_whole_lines;
+
+    /* the producer publishes in steps of this many slots with publish_whole_lines */
+    static constexpr size_t line_slots = sizeof(Slot) < CACHE_LINE ? CACHE_LINE / sizeof(Slot) : 1;
+
+    /* inline rings have no geometry to copy, see producerRing() */
+    struct NoGeometry {};
+    using GeometryCopy = std::conditional_t<N == dynamic_slots, SlotGeometry<Slot, N>, NoGeometry>;
+
+    /* raw storage, slots are constructed on push and destroyed on pop */
+    SlotStorage<Slot, N> storage;
 
     /* producer and consumer are aligned to cache line
-     * size in order to avoid false sharing */
+     * size in order to avoid false sharing. They count items pushed
+     * and popped since construction and are only masked to address a
+     * slot, so full (producer - consumer == capacity) and empty differ
+     * without a slack slot. */
     alignas(CACHE_LINE) std::atomic<size_t> producer{0};
+    /* the side waiting on a cursor keeps its wait state next to it */
+    typename Traits::ConsumerWait consumer_wait;
+    /* set by close(), read by the consumer only after finding the ring
+     * empty, right after loading producer from the same line */
+    std::atomic<uint32_t> closed{0};
     alignas(CACHE_LINE) std::atomic<size_t> consumer{0};
+    typename Traits::ProducerWait producer_wait;
 
     /* cursors as cache is used to reduce MESI protocol traffic
      * between shared caches, this improve throughput */
     alignas(CACHE_LINE) size_t push_cursor_cache = 0;
+    /* each side's own position, ahead of its published cursor by the
+     * items not yet published, its copy of the ring geometry and its
+     * counters share that line */
+    size_t write_cursor = 0;
+    GeometryCopy producer_geometry;
+    typename Traits::Stats producer_stats;
     alignas(CACHE_LINE) size_t pop_cursor_cache = 0;
+    size_t read_cursor = 0;
+    GeometryCopy consumer_geometry;
+    typename Traits::Stats consumer_stats;
+
+    using Geometry = SlotGeometry<Slot, N>;
+
+    /* the ring as one side addresses it */
+    struct Ring : Geometry {
+        inline __attribute__((always_inline)) size_t
+        offset(size_t cursor) const noexcept {
+            return cursor & this->mask;
+        }
+
+        inline __attribute__((always_inline)) size_t
+        capacity() const noexcept {
+            return this->mask + 1;
+        }
+
+        inline __attribute__((always_inline)) T*
+        items() const noexcept {
+            static_assert(!Layout::stamped, "stamped slots are not contiguous");
+            return this->data;
+        }
+
+        inline __attribute__((always_inline)) Slot&
+        raw(size_t cursor) const noexcept {
+            return this->data[offset(cursor)];
+        }
+
+        inline __attribute__((always_inline)) T*
+        slot(size_t cursor) const noexcept {
+            if constexpr (Layout::stamped) {
+                return std::launder(reinterpret_cast<T*>(raw(cursor).value));
+            } else {
+                return this->data + offset(cursor);
+            }
+        }
+
+        /* true when the slot at cursor is the first one starting in its cache line */
+        inline __attribute__((always_inline)) bool
+        startsLine(size_t cursor) const noexcept {
+            return (offset(cursor) * sizeof(Slot)) % CACHE_LINE < sizeof(Slot);
+        }
+    };
 
-    inline __attribute__((always_inline)) size_t
-    nextIndex(size_t i) const noexcept {
-        return (i + 1) & mask;
+    /* A dynamic ring copies the storage pointer and mask to each side's
+     * private line, so an operation reads only that line and the shared
+     * cursor ones. An inline ring addresses its slots from this: nothing
+     * to copy, and a queue in shared memory stores no pointer. */
+    inline __attribute__((always_inline)) Ring
+    producerRing() noexcept {
+        if constexpr (N == dynamic_slots) {
+            return {producer_geometry};
+        } else {
+            return {storage.geometry()};
+        }
     }
 
-public:
-    explicit SPSCQueue(size_t slots_) : items(slots_), mask(slots_ - 1) {
-        assert((slots_ & (slots_ - 1)) == 0);
+    inline __attribute__((always_inline)) Ring
+    consumerRing() noexcept {
+        if constexpr (N == dynamic_slots) {
+            return {consumer_geometry};
+        } else {
+            return {storage.geometry()};
+        }
+    }
+
+    /* marks n slots from index full, before they are published */
+    inline __attribute__((always_inline)) void
+    stampRun(size_t index, size_t n) noexcept {
+        if constexpr (Layout::stamped) {
+            Ring const ring = producerRing();
+            for (size_t i = 0; i < n; ++i) {
+                ring.raw(index + i).full.store(1, std::memory_order_release);
+            }
+        } else {
+            (void)index;
+            (void)n;
+        }
+    }
+
+    /* marks n slots from index empty, before they are released */
+    inline __attribute__((always_inline)) void
+    unstampRun(size_t index, size_t n) noexcept {
+        if constexpr (Layout::stamped) {
+            Ring const ring = consumerRing();
+            for (size_t i = 0; i < n; ++i) {
+                ring.raw(index + i).full.store(0, std::memory_order_relaxed);
+            }
+        } else {
+            (void)index;
+            (void)n;
+        }
     }
 
     inline void
-    push(const T& value) {
-        size_t const index = producer.load(std::memory_order_relaxed);
-        size_t const next = nextIndex(index);
+    initSlots() noexcept {
+        if constexpr (Layout::stamped) {
+            for (size_t i = 0; i <= storage.mask; ++i) ::new (static_cast<void*>(storage.items() + i)) Slot;
+        }
+    }
+
+    inline __attribute__((always_inline)) void
+    refreshPushCache(size_t index) noexcept {
+        /* the consumer may be waiting for the pending items to make room */
+        if constexpr (Traits::producer_batch > 1 || Traits::publish_whole_lines) flushProducer();
+        push_cursor_cache = consumer.load(std::memory_order_acquire);
+        producer_stats.onRefresh(index - push_cursor_cache);
+    }
+
+    inline __attribute__((always_inline)) void
+    refreshPopCache(size_t index) noexcept {
+        if constexpr (Traits::consumer_batch > 1) flushConsumer();
+        if constexpr (Layout::stamped) {
+            /* stop at a full ring, the next stamp would be index's own */
+            Ring const ring = consumerRing();
+            size_t cursor = pop_cursor_cache;
+            for (size_t scanned = 0; scanned < Layout::scan_limit && cursor - index != ring.capacity()
+                    && ring.raw(cursor).full.load(std::memory_order_acquire) != 0; ++scanned) {
+                ++cursor;
+            }
+            pop_cursor_cache = cursor;
+        } else {
+            pop_cursor_cache = producer.load(std::memory_order_acquire);
+        }
+        consumer_stats.onRefresh(pop_cursor_cache - index);
+    }
+
+    /* Each side's hot private fields sit in one cache line, and the four
+     * lines a push or pop may touch (both cursors, both private lines)
+     * are distinct. The queue has no virtual bases, so GCC and Clang
+     * support offsetof on it even when it isn't standard layout. */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Winvalid-offsetof"
+    static constexpr void
+    checkLayout() noexcept {
+        constexpr size_t producer_line = offsetof(SPSCQueue, producer) / CACHE_LINE;
+        constexpr size_t consumer_line = offsetof(SPSCQueue, consumer) / CACHE_LINE;
+        constexpr size_t push_line = offsetof(SPSCQueue, push_cursor_cache) / CACHE_LINE;
+        constexpr size_t pop_line = offsetof(SPSCQueue, pop_cursor_cache) / CACHE_LINE;
+        static_assert((offsetof(SPSCQueue, producer_geometry) + sizeof(GeometryCopy) - 1) / CACHE_LINE == push_line
+                      && offsetof(SPSCQueue, write_cursor) / CACHE_LINE == push_line,
+                      "the producer's private fields must share a cache line");
+        static_assert((offsetof(SPSCQueue, consumer_geometry) + sizeof(GeometryCopy) - 1) / CACHE_LINE == pop_line
+                      && offsetof(SPSCQueue, read_cursor) / CACHE_LINE == pop_line,
+                      "the consumer's private fields must share a cache line");
+        static_assert(producer_line != consumer_line && push_line != pop_line
+                      && push_line != producer_line && push_line != consumer_line
+                      && pop_line != producer_line && pop_line != consumer_line,
+                      "cursors and private lines must not share a cache line");
+    }
+#pragma GCC diagnostic pop
+
+    static constexpr size_t prefetch_distance = Traits::Prefetch::template distance<Slot>;
+
+    inline __attribute__((always_inline)) void
+    prefetchPush(size_t index) noexcept {
+        if constexpr (prefetch_distance != 0) {
+            Ring const ring = producerRing();
+            size_t const ahead = index + prefetch_distance;
+            if (ahead - push_cursor_cache < ring.capacity() && ring.startsLine(ahead)) {
+                __builtin_prefetch(ring.slot(ahead), 1, 3);
+            }
+        } else {
+            (void)index;
+        }
+    }
+
+    inline __attribute__((always_inline)) void
+    prefetchPop(size_t index) noexcept {
+        if constexpr (prefetch_distance != 0) {
+            Ring const ring = consumerRing();
+            size_t const ahead = index + prefetch_distance;
+            if (pop_cursor_cache - ahead - 1 < ring.capacity() && ring.startsLine(ahead)) {
+                __builtin_prefetch(ring.slot(ahead), 0, 3);
+            }
+        } else {
+            (void)index;
+        }
+    }
+
+    /* one round of a blocking producer operation that found the ring full */
+    inline __attribute__((always_inline)) void
+    waitPush(unsigned round) noexcept {
+        producer_stats.onWaitRound();
+        producer_wait.wait(consumer, push_cursor_cache, round);
+    }
+
+    inline __attribute__((always_inline)) void
+    waitPop(unsigned round) noexcept {
+        consumer_stats.onWaitRound();
+        consumer_wait.wait(producer, pop_cursor_cache, round);
+    }
+
+    inline __attribute__((always_inline)) void
+    publishProducer(size_t index) noexcept {
+        write_cursor = index;
+        if constexpr (Traits::publish_whole_lines) {
+            /* the first slot of index's line, once every earlier line is complete;
+             * a flush may have published past it already */
+            index &= ~(line_slots - 1);
+            if (index - producer.load(std::memory_order_relaxed) - 1 >= producerRing().capacity()) return;
+        } else if constexpr (Traits::producer_batch > 1) {
+            if (index - producer.load(std::memory_order_relaxed) < Traits::producer_batch) return;
+        }
+        producer.store(index, std::memory_order_release);
+        consumer_wait.notify(producer);
+    }
+
+    inline __attribute__((always_inline)) void
+    publishConsumer(size_t index) noexcept {
+        read_cursor = index;
+        if constexpr (Traits::consumer_batch > 1) {
+            if (index - consumer.load(std::memory_order_relaxed) < Traits::consumer_batch) return;
+        }
+        consumer.store(index, std::memory_order_release);
+        producer_wait.notify(consumer);
+    }
+
+    /* the clock is only read every this many failed attempts */
+    static constexpr unsigned clock_check_interval = 64;
+
+    /* close() doesn't move the cursor a parked consumer sleeps on,
+     * receive() sleeps at most this long before checking for it */
+    static constexpr std::chrono::milliseconds close_check_interval{1};
+
+    /* retries attempt() through the side's wait strategy until it succeeds
+     * or the deadline passes, seen is the cursor cache attempt() refreshes */
+    template<typename Wait, typename Stats, typename Attempt, typename Clock, typename Duration> inline bool
+    retryUntil(Wait& wait, Stats& stats, const std::atomic<size_t>& cursor, const size_t& seen,
+               Attempt&& attempt, const std::chrono::time_point<Clock, Duration>& deadline) {
+        for (unsigned round = 0;; ++round) {
+            if (attempt()) return true;
+            if (round % clock_check_interval == clock_check_interval - 1 && Clock::now() >= deadline) {
+                return false;
+            }
+            stats.onWaitRound();
+            wait.waitUntil(cursor, seen, round, deadline);
+        }
+    }
+
+    /* copy-constructs a run of n items into the ring starting at index,
+     * splitting it in two at the wrap point */
+    inline void
+    writeRun(size_t index, const T* src, size_t n) {
+        Ring const ring = producerRing();
+        if constexpr (Layout::stamped) {
+            for (size_t i = 0; i < n; ++i) ::new (static_cast<void*>(ring.slot(index + i))) T(src[i]);
+        } else if constexpr (std::is_trivially_copyable<T>::value) {
+            size_t const first = std::min(n, ring.capacity() - ring.offset(index));
+            Traits::Copy::copy(ring.items() + ring.offset(index), src, first * sizeof(T));
+            if (first != n) Traits::Copy::copy(ring.items(), src + first, (n - first) * sizeof(T));
+        } else {
+            size_t const first = std::min(n, ring.capacity() - ring.offset(index));
+            std::uninitialized_copy_n(src, first, ring.items() + ring.offset(index));
+            std::uninitialized_copy_n(src + first, n - first, ring.items());
+        }
+        stampRun(index, n);
+    }
+
+    /* moves a run of n items out of the ring and destroys the slots */
+    inline void
+    readRun(size_t index, T* dst, size_t n) {
+        Ring const ring = consumerRing();
+        if constexpr (Layout::stamped) {
+            for (size_t i = 0; i < n; ++i) {
+                T* item = ring.slot(index + i);
+                dst[i] = std::move(*item);
+                item->~T();
+            }
+        } else if constexpr (std::is_trivially_copyable<T>::value) {
+            size_t const first = std::min(n, ring.capacity() - ring.offset(index));
+            std::memcpy(static_cast<void*>(dst), ring.items() + ring.offset(index), first * sizeof(T));
+            std::memcpy(static_cast<void*>(dst + first), ring.items(), (n - first) * sizeof(T));
+        } else {
+            size_t const first = std::min(n, ring.capacity() - ring.offset(index));
+            std::move(ring.items() + ring.offset(index), ring.items() + ring.offset(index) + first, dst);
+            std::destroy_n(ring.items() + ring.offset(index), first);
+            std::move(ring.items(), ring.items() + (n - first), dst + first);
+            std::destroy_n(ring.items(), n - first);
+        }
+        unstampRun(index, n);
+    }
+
+public:
+    template<size_t M = N, typename = std::enable_if_t<M == dynamic_slots>>
+    explicit SPSCQueue(size_t slots_, const SlotAllocation& alloc = {}) : storage(slots_, alloc) {
+        producer_geometry = consumer_geometry = storage.geometry();
+        initSlots();
+    }
+
+    template<size_t M = N, typename = std::enable_if_t<M != dynamic_slots>>
+    SPSCQueue() {
+        initSlots();
+    }
+
+    ~SPSCQueue() {
+        checkLayout();
+        Ring const ring = consumerRing();
+        for (size_t i = read_cursor; i != write_cursor; ++i) {
+            ring.slot(i)->~T();
+        }
+    }
+
+    SPSCQueue(const SPSCQueue&) = delete;
+    SPSCQueue& operator=(const SPSCQueue&) = delete;
 
-        while (next == push_cursor_cache) {
-            /* In this line, the `asm pause` function is commented out,
-             * assuming the consumer is hotter than the producer.
-             * Uncomment this line below if the producer has a higher throughput.
-             * spinLoopHint(); */
-            push_cursor_cache = consumer.load(std::memory_order_acquire);
+    template<typename... Args> inline void
+    emplace(Args&&... args) {
+        Ring const ring = producerRing();
+        size_t const index = write_cursor;
+
+        if (index - push_cursor_cache == ring.capacity()) {
+            refreshPushCache(index);
+            for (unsigned round = 0; index - push_cursor_cache == ring.capacity(); ++round) {
+                producer_stats.onStall();
+                waitPush(round);
+                refreshPushCache(index);
+            }
+        }
+
+        prefetchPush(index);
+        ::new (static_cast<void*>(ring.slot(index))) T(std::forward<Args>(args)...);
+        stampRun(index, 1);
+        publishProducer(index + 1);
+    }
+
+    template<typename... Args> [[nodiscard]] inline bool
+    tryEmplace(Args&&... args) {
+        Ring const ring = producerRing();
+        size_t const index = write_cursor;
+
+        if (index - push_cursor_cache == ring.capacity()) {
+            refreshPushCache(index);
+            if (index - push_cursor_cache == ring.capacity()) {
+                producer_stats.onStall();
+                return false;
+            }
         }
 
-        items[index] = value;
-        producer.store(next, std::memory_order_release);
+        prefetchPush(index);
+        ::new (static_cast<void*>(ring.slot(index))) T(std::forward<Args>(args)...);
+        stampRun(index, 1);
+        publishProducer(index + 1);
+        return true;
+    }
+
+    inline void
+    push(const T& value) {
+        emplace(value);
+    }
+
+    inline void
+    push(T&& value) {
+        emplace(std::move(value));
     }
 
     [[nodiscard]] inline bool
     tryPush(const T& value) {
-        size_t const index = producer.load(std::memory_order_relaxed);
-        size_t const next = nextIndex(index);
+        return tryEmplace(value);
+    }
+
+    [[nodiscard]] inline bool
+    tryPush(T&& value) {
+        return tryEmplace(std::move(value));
+    }
+
+    /* Pushes value, waiting through ProducerWait until deadline if the queue is full. */
+    template<typename Clock, typename Duration> [[nodiscard]] inline bool
+    tryPushUntil(const T& value, const std::chrono::time_point<Clock, Duration>& deadline) {
+        return retryUntil(producer_wait, producer_stats, consumer, push_cursor_cache,
+                          [&] { return tryEmplace(value); }, deadline);
+    }
+
+    template<typename Clock, typename Duration> [[nodiscard]] inline bool
+    tryPushUntil(T&& value, const std::chrono::time_point<Clock, Duration>& deadline) {
+        /* value is only moved from by the attempt that succeeds */
+        return retryUntil(producer_wait, producer_stats, consumer, push_cursor_cache,
+                          [&] { return tryEmplace(std::move(value)); }, deadline);
+    }
+
+    template<typename Rep, typename Period> [[nodiscard]] inline bool
+    tryPushFor(const T& value, const std::chrono::duration<Rep, Period>& timeout) {
+        return tryEmplace(value) || tryPushUntil(value, std::chrono::steady_clock::now() + timeout);
+    }
 
-        if (next == push_cursor_cache) {
-            push_cursor_cache = consumer.load(std::memory_order_acquire);
-            if (next == push_cursor_cache) return false;
+    template<typename Rep, typename Period> [[nodiscard]] inline bool
+    tryPushFor(T&& value, const std::chrono::duration<Rep, Period>& timeout) {
+        return tryEmplace(std::move(value))
+            || tryPushUntil(std::move(value), std::chrono::steady_clock::now() + timeout);
+    }
+
+    /* Pushes up to n items with a single release store,
+     * returns how many were pushed. */
+    [[nodiscard]] inline size_t
+    tryPushN(const T* src, size_t n) {
+        Ring const ring = producerRing();
+        size_t const index = write_cursor;
+        size_t free = ring.capacity() - (index - push_cursor_cache);
+
+        if (free < n) {
+            refreshPushCache(index);
+            free = ring.capacity() - (index - push_cursor_cache);
+            n = std::min(n, free);
+            if (n == 0) {
+                producer_stats.onStall();
+                return 0;
+            }
         }
 
-        items[index] = value;
-        producer.store(next, std::memory_order_release);
-        return true;
+        writeRun(index, src, n);
+        publishProducer(index + n);
+        return n;
     }
 
-    [[nodiscard]] inline T
+    /* Blocks until all n items are pushed, publishing
+     * each contiguous run of free slots at once. */
+    inline void
+    pushN(const T* src, size_t n) {
+        for (unsigned round = 0; n != 0;) {
+            size_t const pushed = tryPushN(src, n);
+            if (pushed == 0) waitPush(round++);
+            src += pushed;
+            n -= pushed;
+        }
+    }
+
+    /* Returns storage for the next slot, or nullptr if the queue is full.
+     * Construct the item in it (placement new, or plain stores for
+     * trivial types) and publish it with commitWrite(). */
+    [[nodiscard]] inline T*
+    reserveWrite() {
+        Ring const ring = producerRing();
+        size_t const index = write_cursor;
+
+        if (index - push_cursor_cache == ring.capacity()) {
+            refreshPushCache(index);
+            if (index - push_cursor_cache == ring.capacity()) {
+                producer_stats.onStall();
+                return nullptr;
+            }
+        }
+
+        prefetchPush(index);
+        return ring.slot(index);
+    }
+
+    /* Returns storage for up to max contiguous free slots (stops at the wrap point),
+     * empty if the queue is full. Publish them with commitWrite(n). */
+    [[nodiscard]] inline SlotSpan<T>
+    reserveWriteSpan(size_t max) {
+        Ring const ring = producerRing();
+        size_t const index = write_cursor;
+        size_t free = ring.capacity() - (index - push_cursor_cache);
+
+        if (free < max) {
+            refreshPushCache(index);
+            free = ring.capacity() - (index - push_cursor_cache);
+            if (free == 0) producer_stats.onStall();
+        }
+
+        size_t const contiguous = std::min(free, ring.capacity() - ring.offset(index));
+        return {ring.items() + ring.offset(index), std::min(max, contiguous)};
+    }
+
+    /* Publishes n slots previously obtained from reserveWrite*(). */
+    inline void
+    commitWrite(size_t n = 1) {
+        size_t const index = write_cursor;
+        stampRun(index, n);
+        publishProducer(index + n);
+    }
+
+    /* Blocking pops: pop(), skip(), popN(), receive() and popAsync(). */
+    template<bool B = blocking_pops, typename = std::enable_if_t<B>> [[nodiscard]] inline T
     pop() {
-        size_t const index = consumer.load(std::memory_order_relaxed);
-        while (index == pop_cursor_cache) {
-            spinLoopHint();
-            pop_cursor_cache = producer.load(std::memory_order_acquire);
+        Ring const ring = consumerRing();
+        size_t const index = read_cursor;
+        if (index == pop_cursor_cache) {
+            refreshPopCache(index);
+            for (unsigned round = 0; index == pop_cursor_cache; ++round) {
+                consumer_stats.onStall();
+                waitPop(round);
+                refreshPopCache(index);
+            }
         }
 
-        T const value = items[index];
-        consumer.store(nextIndex(index), std::memory_order_release);
+        prefetchPop(index);
+        T value = std::move(*ring.slot(index));
+        ring.slot(index)->~T();
+        unstampRun(index, 1);
+        publishConsumer(index + 1);
         return value;
     }
 
-    inline void
+    template<bool B = blocking_pops, typename = std::enable_if_t<B>> inline void
     skip() {
         (void)pop();
     }
 
     [[nodiscard]] inline bool
     tryPop(T& out) {
-        size_t const index = consumer.load(std::memory_order_relaxed);
+        Ring const ring = consumerRing();
+        size_t const index = read_cursor;
         if (index == pop_cursor_cache) {
-            pop_cursor_cache = producer.load(std::memory_order_acquire);
-            if (index == pop_cursor_cache) return false;
+            refreshPopCache(index);
+            if (index == pop_cursor_cache) {
+                consumer_stats.onStall();
+                return false;
+            }
         }
 
-        out = items[index];
-        consumer.store(nextIndex(index), std::memory_order_release);
+        prefetchPop(index);
+        out = std::move(*ring.slot(index));
+        ring.slot(index)->~T();
+        unstampRun(index, 1);
+        publishConsumer(index + 1);
         return true;
     }
 
+    /* Pops into out, waiting through ConsumerWait until deadline if the queue is empty. */
+    template<typename Clock, typename Duration> [[nodiscard]] inline bool
+    tryPopUntil(T& out, const std::chrono::time_point<Clock, Duration>& deadline) {
+        return retryUntil(consumer_wait, consumer_stats, producer, pop_cursor_cache,
+                          [&] { return tryPop(out); }, deadline);
+    }
+
+    template<typename Rep, typename Period> [[nodiscard]] inline bool
+    tryPopFor(T& out, const std::chrono::duration<Rep, Period>& timeout) {
+        return tryPop(out) || tryPopUntil(out, std::chrono::steady_clock::now() + timeout);
+    }
+
+    /* Pops up to max items with a single release store,
+     * returns how many were popped. */
+    [[nodiscard]] inline size_t
+    tryPopN(T* dst, size_t max) {
+        size_t const index = read_cursor;
+        size_t available = pop_cursor_cache - index;
+
+        if (available < max) {
+            refreshPopCache(index);
+            available = pop_cursor_cache - index;
+            max = std::min(max, available);
+            if (max == 0) {
+                consumer_stats.onStall();
+                return 0;
+            }
+        }
+
+        readRun(index, dst, max);
+        publishConsumer(index + max);
+        return max;
+    }
+
+    /* Returns the oldest item without removing it, or nullptr
+     * if the queue is empty. Release it with popFront(). */
+    [[nodiscard]] inline const T*
+    front() {
+        return frontMutable();
+    }
+
+    /* front() for a consumer that moves the item out before popFront(). */
+    [[nodiscard]] inline T*
+    frontMutable() {
+        Ring const ring = consumerRing();
+        size_t const index = read_cursor;
+        if (index == pop_cursor_cache) {
+            refreshPopCache(index);
+            if (index == pop_cursor_cache) {
+                consumer_stats.onStall();
+                return nullptr;
+            }
+        }
+
+        prefetchPop(index);
+        return ring.slot(index);
+    }
+
+    /* Returns up to max contiguous readable slots (stops at the wrap point),
+     * empty if the queue is empty. Release them with popFront(n). */
+    [[nodiscard]] inline SlotSpan<const T>
+    frontSpan(size_t max) {
+        Ring const ring = consumerRing();
+        size_t const index = read_cursor;
+        size_t available = pop_cursor_cache - index;
+
+        if (available < max) {
+            refreshPopCache(index);
+            available = pop_cursor_cache - index;
+            if (available == 0) consumer_stats.onStall();
+        }
+
+        size_t const contiguous = std::min(available, ring.capacity() - ring.offset(index));
+        return {ring.items() + ring.offset(index), std::min(max, contiguous)};
+    }
+
+    /* Destroys and releases n slots previously obtained from front*(). */
+    inline void
+    popFront(size_t n = 1) {
+        Ring const ring = consumerRing();
+        size_t const index = read_cursor;
+        if constexpr (Layout::stamped) {
+            for (size_t i = 0; i < n; ++i) ring.slot(index + i)->~T();
+        } else {
+            size_t const first = std::min(n, ring.capacity() - ring.offset(index));
+            std::destroy_n(ring.items() + ring.offset(index), first);
+            std::destroy_n(ring.items(), n - first);
+        }
+        unstampRun(index, n);
+        publishConsumer(index + n);
+    }
+
+    /* Hands up to max items to fn(T&) in place, oldest first, then destroys
+     * them and releases their slots with a single store. The producer cursor
+     * is read at most once. Returns how many items fn saw. If fn throws,
+     * the batch stays queued, items already handled included. */
+    template<typename Fn> inline size_t
+    consumeUpTo(size_t max, Fn&& fn) {
+        Ring const ring = consumerRing();
+        size_t const index = read_cursor;
+        size_t available = pop_cursor_cache - index;
+
+        if (available < max) {
+            refreshPopCache(index);
+            available = pop_cursor_cache - index;
+            max = std::min(max, available);
+            if (max == 0) {
+                consumer_stats.onStall();
+                return 0;
+            }
+        }
+
+        if constexpr (Layout::stamped) {
+            for (size_t i = 0; i < max; ++i) fn(*ring.slot(index + i));
+        } else {
+            /* two plain loops over contiguous slots the compiler can unroll */
+            size_t const first = std::min(max, ring.capacity() - ring.offset(index));
+            T* const run = ring.items() + ring.offset(index);
+            for (size_t i = 0; i < first; ++i) fn(run[i]);
+            for (size_t i = 0; i < max - first; ++i) fn(ring.items()[i]);
+        }
+        popFront(max);
+        return max;
+    }
+
+    /* consumeUpTo() over everything published so far. */
+    template<typename Fn> inline size_t
+    consumeAll(Fn&& fn) {
+        Ring const ring = consumerRing();
+        return consumeUpTo(ring.capacity(), std::forward<Fn>(fn));
+    }
+
+    /* Producer side: ends the stream after publishing pending items. The
+     * consumer pops everything pushed before, then receive() and
+     * tryReceive() report PopStatus::closed. Nothing may be pushed after. */
+    inline void
+    close() noexcept {
+        flushProducer();
+        closed.store(1, std::memory_order_release);
+        consumer_wait.notify(producer);
+    }
+
+    [[nodiscard]] inline bool
+    isClosed() const noexcept {
+        return closed.load(std::memory_order_acquire) != 0;
+    }
+
+    /* Pops into out if an item is available, otherwise tells
+     * an empty queue from a closed and drained one. */
+    [[nodiscard]] inline PopStatus
+    tryReceive(T& out) {
+        if (tryPop(out)) return PopStatus::ok;
+        if (closed.load(std::memory_order_acquire) == 0) return PopStatus::empty;
+        /* items pushed before close() are visible now */
+        return tryPop(out) ? PopStatus::ok : PopStatus::closed;
+    }
+
+    /* Blocks until an item is popped into out (ok) or
+     * the queue is closed and drained (closed). */
+    template<bool B = blocking_pops, typename = std::enable_if_t<B>> [[nodiscard]] inline PopStatus
+    receive(T& out) {
+        auto deadline = std::chrono::steady_clock::time_point::min();
+        for (unsigned round = 0;; ++round) {
+            PopStatus const status = tryReceive(out);
+            if (status != PopStatus::empty) return status;
+            if (round % clock_check_interval == 0) deadline = std::chrono::steady_clock::now() + close_check_interval;
+            consumer_stats.onWaitRound();
+            consumer_wait.waitUntil(producer, pop_cursor_cache, round, deadline);
+        }
+    }
+
+    /* Blocks until n items are popped. */
+    template<bool B = blocking_pops, typename = std::enable_if_t<B>> inline void
+    popN(T* dst, size_t n) {
+        for (unsigned round = 0; n != 0;) {
+            size_t const popped = tryPopN(dst, n);
+            if (popped == 0) waitPop(round++);
+            dst += popped;
+            n -= popped;
+        }
+    }
+
+    /* Consumer side, for wait strategies backed by an external notifier
+     * (EventFdWait): asks for a notification on the next push, then
+     * returns false if items arrived meanwhile and the caller should
+     * keep draining instead of going idle. */
+    [[nodiscard]] inline bool
+    rearm() {
+        flushConsumer();
+        consumer_wait.arm();
+        size_t const index = read_cursor;
+        pop_cursor_cache = producer.load(std::memory_order_seq_cst);
+        if (index == pop_cursor_cache) return true;
+
+        consumer_wait.disarm();
+        return false;
+    }
+
+    /* C++20 coroutines, with CoroutineWait (coroutine_wait.hpp) as the
+     * side's wait strategy: co_await popAsync() yields the next item,
+     * co_await receiveAsync(out) a PopStatus and co_await pushAsync(value)
+     * pushes. Each completes in place when it can and otherwise suspends
+     * until the other side next publishes. */
+    template<typename Queue = SPSCQueue> [[nodiscard]] inline auto
+    popAsync() noexcept {
+        static_assert(blocking_pops, "publish_whole_lines: a partial line is never seen without flushProducer()");
+        return typename Traits::ConsumerWait::template PopAwaiter<Queue>(*this);
+    }
+
+    template<typename Queue = SPSCQueue> [[nodiscard]] inline auto
+    receiveAsync(T& out) noexcept {
+        static_assert(blocking_pops, "publish_whole_lines: a partial line is never seen without flushProducer()");
+        return typename Traits::ConsumerWait::template ReceiveAwaiter<Queue>(*this, out);
+    }
+
+    template<typename Queue = SPSCQueue> [[nodiscard]] inline auto
+    pushAsync(T value) {
+        return typename Traits::ProducerWait::template PushAwaiter<Queue>(*this, std::move(value));
+    }
+
+    [[nodiscard]] inline typename Traits::ConsumerWait&
+    consumerWait() noexcept {
+        return consumer_wait;
+    }
+
+    [[nodiscard]] inline typename Traits::ProducerWait&
+    producerWait() noexcept {
+        return producer_wait;
+    }
+
+    /* Producer side: publishes items still held back by Traits::producer_batch
+     * or, with Traits::publish_whole_lines, in a partially written line.
+     * Call it at the end of a burst, the consumer doesn't see them otherwise. */
+    inline void
+    flushProducer() noexcept {
+        if (producer.load(std::memory_order_relaxed) != write_cursor) {
+            producer.store(write_cursor, std::memory_order_release);
+            consumer_wait.notify(producer);
+        }
+    }
+
+    /* Consumer side: releases slots still held back by Traits::consumer_batch. */
+    inline void
+    flushConsumer() noexcept {
+        if (consumer.load(std::memory_order_relaxed) != read_cursor) {
+            consumer.store(read_cursor, std::memory_order_release);
+            producer_wait.notify(consumer);
+        }
+    }
+
+    /* Counters of the Traits::Stats policy, all zero with NoStats.
+     * Safe to call from any thread while the queue is in use. */
+    [[nodiscard]] inline QueueStatsSnapshot
+    stats() const noexcept {
+        return {producer_stats.snapshot(), consumer_stats.snapshot()};
+    }
+
+    [[nodiscard]] inline size_t
+    capacity() const noexcept {
+        if constexpr (N == dynamic_slots) {
+            return producer_geometry.mask + 1;
+        } else {
+            return N;
+        }
+    }
+
+    /* count() and isEmpty() see published cursors only, with batched
+     * publication they leave out pending items and released slots. */
     [[nodiscard]] inline size_t
     count() const noexcept {
         size_t const write_index = producer.load(std::memory_order_acquire);
         size_t const read_index = consumer.load(std::memory_order_acquire);
-        return (write_index - read_index) & mask;
+        return write_index - read_index;
     }
 
     [[nodiscard]] inline bool
@@ -170,3 +1475,6 @@ public:
         return write_index == read_index;
     }
 };
+
+template<typename T, size_t N, typename Traits = DefaultQueueTraits>
+using StaticSPSCQueue = SPSCQueue<T, N, Traits>;
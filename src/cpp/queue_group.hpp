@@ -0,0 +1,231 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) Andrea Vaccaro
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Source: https://github.com/ANDRVV/SPSCQueue
+ * Fan-in of up to 64 SPSCQueue lanes drained by a single consumer.
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "queue.hpp"
+
+/* Ready mask of a group, with the word its consumer sleeps on once every
+ * lane stayed empty for a while. sleeping is set before the consumer
+ * rechecks the mask and a producer reads it after setting a bit, so one of
+ * the two always sees the other. */
+struct GroupSignal {
+    /* bit i set: lane i may be non-empty */
+    std::atomic<uint64_t> ready{0};
+    std::atomic<uint32_t> sleeping{0};
+    std::atomic<size_t> wakeups{0};
+};
+
+/* Consumer wait strategy of a group lane: on every push it makes sure the
+ * lane's bit is set in the group's ready mask, waking the consumer if it
+ * sleeps. The consumer clears the bit only after finding the lane empty and
+ * rechecks it afterwards, so with the fence on both sides a push is never
+ * left behind a cleared bit. */
+class LaneSignal {
+private:
+    GroupSignal* group = nullptr;
+    uint64_t bit = 0;
+
+public:
+    inline void
+    bind(GroupSignal* group_, uint64_t bit_) noexcept {
+        group = group_;
+        bit = bit_;
+    }
+
+    inline __attribute__((always_inline)) void
+    wait(const std::atomic<size_t>&, size_t, unsigned) noexcept {
+        spinLoopHint();
+    }
+
+    template<typename Clock, typename Duration> inline __attribute__((always_inline)) void
+    waitUntil(const std::atomic<size_t>&, size_t, unsigned,
+              const std::chrono::time_point<Clock, Duration>&) noexcept {
+        spinLoopHint();
+    }
+
+    inline __attribute__((always_inline)) void
+    notify(std::atomic<size_t>&) noexcept {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        /* the read keeps the line shared while the bit is already set */
+        if ((group->ready.load(std::memory_order_relaxed) & bit) == 0) {
+            group->ready.fetch_or(bit, std::memory_order_seq_cst);
+            if (group->sleeping.load(std::memory_order_seq_cst) != 0) {
+                group->wakeups.fetch_add(1, std::memory_order_relaxed);
+                futexWake(group->wakeups);
+            }
+        }
+    }
+};
+
+/* One SPSCQueue per producer, one consumer draining them all. Producers
+ * push to lane(i) with the usual SPSCQueue API; the consumer pops through
+ * the group, which only visits lanes flagged in a ready mask kept on its
+ * own cache line, so idle lanes cost nothing. Lanes are served round-robin.
+ * Traits::ConsumerWait is replaced by LaneSignal on every lane. */
+template<typename T, typename Traits = DefaultQueueTraits>
+class SPSCQueueGroup {
+public:
+    struct LaneTraits : Traits {
+        using ConsumerWait = LaneSignal;
+    };
+    using Lane = SPSCQueue<T, dynamic_slots, LaneTraits>;
+
+    static constexpr size_t max_lanes = 64;
+
+    /* empty passes over the ready mask pop() spins before sleeping */
+    static constexpr unsigned spin_rounds = 256;
+
+private:
+    std::vector<std::unique_ptr<Lane>> lanes;
+
+    alignas(CACHE_LINE) GroupSignal signal;
+
+    /* consumer private: ready lanes not yet visited in this round and the next lane to serve */
+    alignas(CACHE_LINE) uint64_t pending = 0;
+    size_t next_lane = 0;
+
+    /* Returns the next lane to serve in round-robin order, refreshing
+     * the pending set from the ready mask once a round is done. */
+    inline bool
+    nextReady(size_t& lane) noexcept {
+        if (pending == 0) {
+            pending = signal.ready.load(std::memory_order_acquire);
+            if (pending == 0) return false;
+        }
+        uint64_t const after = next_lane < max_lanes ? pending & (~uint64_t{0} << next_lane) : 0;
+        lane = static_cast<size_t>(__builtin_ctzll(after != 0 ? after : pending));
+        pending &= ~(uint64_t{1} << lane);
+        next_lane = lane + 1;
+        return true;
+    }
+
+    /* called after a lane was found empty */
+    inline void
+    retire(size_t lane) noexcept {
+        uint64_t const bit = uint64_t{1} << lane;
+        signal.ready.fetch_and(~bit, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!lanes[lane]->isEmpty()) signal.ready.fetch_or(bit, std::memory_order_relaxed);
+    }
+
+    /* Sleeps until a producer sets a bit in the ready mask. */
+    inline void
+    sleep() noexcept {
+        signal.sleeping.store(1, std::memory_order_seq_cst);
+        size_t const seen = signal.wakeups.load(std::memory_order_seq_cst);
+        if (signal.ready.load(std::memory_order_seq_cst) == 0) futexWait(signal.wakeups, seen);
+        signal.sleeping.store(0, std::memory_order_relaxed);
+    }
+
+public:
+    explicit SPSCQueueGroup(size_t lane_count, size_t slots, const SlotAllocation& alloc = {}) {
+        assert(lane_count != 0 && lane_count <= max_lanes);
+        lanes.reserve(lane_count);
+        for (size_t i = 0; i < lane_count; ++i) {
+            lanes.push_back(std::make_unique<Lane>(slots, alloc));
+            lanes.back()->consumerWait().bind(&signal, uint64_t{1} << i);
+        }
+    }
+
+    SPSCQueueGroup(const SPSCQueueGroup&) = delete;
+    SPSCQueueGroup& operator=(const SPSCQueueGroup&) = delete;
+
+    /* The queue producer i pushes to. Don't pop from it directly. */
+    [[nodiscard]] inline Lane&
+    lane(size_t i) noexcept {
+        return *lanes[i];
+    }
+
+    [[nodiscard]] inline size_t
+    laneCount() const noexcept {
+        return lanes.size();
+    }
+
+    /* Pops one item from the next ready lane, storing its index in
+     * from_lane when given. Returns false if every lane is empty. */
+    [[nodiscard]] inline bool
+    tryPop(T& out, size_t* from_lane = nullptr) {
+        size_t lane;
+        while (nextReady(lane)) {
+            if (lanes[lane]->tryPop(out)) {
+                if (from_lane != nullptr) *from_lane = lane;
+                return true;
+            }
+            retire(lane);
+        }
+        return false;
+    }
+
+    /* Waits for an item from any lane: spins spin_rounds empty passes,
+     * then sleeps on the ready mask until a producer flags a lane. */
+    [[nodiscard]] inline T
+    pop(size_t* from_lane = nullptr) {
+        size_t lane;
+        for (unsigned round = 0;; ++round) {
+            while (nextReady(lane)) {
+                if (T* item = lanes[lane]->frontMutable()) {
+                    T value = std::move(*item);
+                    lanes[lane]->popFront();
+                    if (from_lane != nullptr) *from_lane = lane;
+                    return value;
+                }
+                retire(lane);
+            }
+            if (round < spin_rounds) spinLoopHint();
+            else sleep();
+        }
+    }
+
+    /* One round-robin pass over the ready lanes, handing up to batch items
+     * of each to fn(lane, T&) in place and releasing them with one store
+     * per lane. Returns the number of items consumed. */
+    template<typename Fn> inline size_t
+    drain(Fn&& fn, size_t batch = 32) {
+        size_t consumed = 0;
+        uint64_t round = signal.ready.load(std::memory_order_acquire);
+        pending = 0;
+        while (round != 0) {
+            size_t const lane = static_cast<size_t>(__builtin_ctzll(round));
+            round &= round - 1;
+
+            size_t const taken = lanes[lane]->consumeUpTo(batch, [&](T& item) { fn(lane, item); });
+            consumed += taken;
+            if (taken != batch) retire(lane);
+        }
+        return consumed;
+    }
+
+    /* Ready mask snapshot, for diagnostics. */
+    [[nodiscard]] inline uint64_t
+    readyMask() const noexcept {
+        return signal.ready.load(std::memory_order_relaxed);
+    }
+};
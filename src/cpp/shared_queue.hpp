@@ -0,0 +1,209 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) Andrea Vaccaro
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Source: https://github.com/ANDRVV/SPSCQueue
+ * A process-shared SPSCQueue placed in a memory-mapped region.
+ */
+
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/statfs.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <stdexcept>
+#include <system_error>
+
+#include "queue.hpp"
+
+/* bumped on any change to SharedQueueHeader or to the queue layout after it */
+inline constexpr uint32_t shared_queue_version = 4;
+inline constexpr uint32_t shared_queue_magic = 0x53505343; /* "SPSC" */
+
+/* Fixed header at the start of the shared region, the queue follows
+ * on the next cache line. magic is stored last by the creator, so an
+ * attacher never sees a half-initialized queue. */
+struct alignas(CACHE_LINE) SharedQueueHeader {
+    std::atomic<uint32_t> magic;
+    uint32_t version;
+    uint64_t capacity;
+    uint64_t element_size;
+    uint64_t element_align;
+};
+
+/* Owns the mapping of a StaticSPSCQueue<T, N> shared between two processes.
+ * The queue holds no pointers and the cursor caches are per side, so each
+ * process only touches its own side once attached. */
+template<typename T, size_t N>
+class SharedSPSCQueue {
+    static_assert(N != dynamic_slots, "shared queues need a compile-time capacity");
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "T must be trivially copyable to cross process boundaries");
+    static_assert(std::atomic<size_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+                  "process-shared atomics must be lock-free");
+
+private:
+    struct Region {
+        SharedQueueHeader header;
+        SPSCQueue<T, N> queue;
+    };
+
+    Region* region = nullptr;
+    size_t mapped = 0;
+
+    SharedSPSCQueue(Region* region_, size_t mapped_) : region(region_), mapped(mapped_) {}
+
+    [[noreturn]] static void
+    fail(const char* what, int error = errno) {
+        throw std::system_error(error, std::generic_category(), what);
+    }
+
+    /* close() may overwrite errno, report the one of the call that failed */
+    [[noreturn]] static void
+    closeAndFail(int fd, const char* what) {
+        int const error = errno;
+        close(fd);
+        fail(what, error);
+    }
+
+    static SharedSPSCQueue
+    map(int fd, bool create) {
+        size_t size = sizeof(Region);
+        if (create) {
+            /* hugetlbfs reports the huge page size as block size */
+            struct statfs fs;
+            if (fstatfs(fd, &fs) != 0) closeAndFail(fd, "fstatfs");
+            size_t const block = static_cast<size_t>(fs.f_bsize);
+            size = (size + block - 1) / block * block;
+            if (ftruncate(fd, static_cast<off_t>(size)) != 0) closeAndFail(fd, "ftruncate");
+        } else {
+            struct stat st;
+            if (fstat(fd, &st) != 0) closeAndFail(fd, "fstat");
+            if (static_cast<size_t>(st.st_size) < sizeof(Region)) {
+                close(fd);
+                throw std::runtime_error("shared queue region is too small");
+            }
+            size = static_cast<size_t>(st.st_size);
+        }
+
+        void* addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (addr == MAP_FAILED) closeAndFail(fd, "mmap");
+        close(fd);
+
+        SharedSPSCQueue shared(static_cast<Region*>(addr), size);
+        if (create) {
+            Region* fresh = ::new (addr) Region;
+            fresh->header.version = shared_queue_version;
+            fresh->header.capacity = N;
+            fresh->header.element_size = sizeof(T);
+            fresh->header.element_align = alignof(T);
+            fresh->header.magic.store(shared_queue_magic, std::memory_order_release);
+        } else {
+            SharedQueueHeader const& header = shared.region->header;
+            if (header.magic.load(std::memory_order_acquire) != shared_queue_magic)
+                throw std::runtime_error("shared queue is not initialized");
+            if (header.version != shared_queue_version)
+                throw std::runtime_error("shared queue layout version mismatch");
+            if (header.capacity != N || header.element_size != sizeof(T) || header.element_align != alignof(T))
+                throw std::runtime_error("shared queue capacity or element type mismatch");
+        }
+        return shared;
+    }
+
+public:
+    /* Creates and initializes a POSIX shared memory object, fails if it exists. */
+    [[nodiscard]] static SharedSPSCQueue
+    create(const char* name, mode_t mode = 0600) {
+        int const fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, mode);
+        if (fd < 0) fail("shm_open");
+        return map(fd, true);
+    }
+
+    /* Attaches to a queue made by create(), validating its header. */
+    [[nodiscard]] static SharedSPSCQueue
+    attach(const char* name) {
+        int const fd = shm_open(name, O_RDWR, 0);
+        if (fd < 0) fail("shm_open");
+        return map(fd, false);
+    }
+
+    /* Same as create() on a regular file path, e.g. on a hugetlbfs mount. */
+    [[nodiscard]] static SharedSPSCQueue
+    createFile(const char* path, mode_t mode = 0600) {
+        int const fd = open(path, O_CREAT | O_EXCL | O_RDWR, mode);
+        if (fd < 0) fail("open");
+        return map(fd, true);
+    }
+
+    [[nodiscard]] static SharedSPSCQueue
+    attachFile(const char* path) {
+        int const fd = open(path, O_RDWR);
+        if (fd < 0) fail("open");
+        return map(fd, false);
+    }
+
+    /* Removes the shared memory name, mappings stay valid until unmapped. */
+    static void
+    unlink(const char* name) {
+        if (shm_unlink(name) != 0) fail("shm_unlink");
+    }
+
+    SharedSPSCQueue(SharedSPSCQueue&& other) noexcept
+        : region(other.region), mapped(other.mapped) {
+        other.region = nullptr;
+        other.mapped = 0;
+    }
+
+    SharedSPSCQueue& operator=(SharedSPSCQueue&& other) noexcept {
+        std::swap(region, other.region);
+        std::swap(mapped, other.mapped);
+        return *this;
+    }
+
+    SharedSPSCQueue(const SharedSPSCQueue&) = delete;
+    SharedSPSCQueue& operator=(const SharedSPSCQueue&) = delete;
+
+    /* Unmaps the region, the queue itself outlives both processes' handles. */
+    ~SharedSPSCQueue() {
+        if (region != nullptr) munmap(region, mapped);
+    }
+
+    [[nodiscard]] inline SPSCQueue<T, N>&
+    queue() noexcept {
+        return region->queue;
+    }
+
+    [[nodiscard]] inline SPSCQueue<T, N>*
+    operator->() noexcept {
+        return &region->queue;
+    }
+
+    [[nodiscard]] inline const SharedQueueHeader&
+    header() const noexcept {
+        return region->header;
+    }
+};
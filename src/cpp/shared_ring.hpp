@@ -0,0 +1,242 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) Andrea Vaccaro
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Source: https://github.com/ANDRVV/SPSCQueue
+ * Language-neutral shared memory ring, binary compatible with SharedRing in queue.zig.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+
+#include "queue.hpp"
+
+/* Binary layout of a shared ring, version 1. Every field is little-endian
+ * native on the supported targets, offsets are from the region start,
+ * which must be 128-byte aligned (mmap'ed regions are):
+ *
+ *     0  u32 magic        "SPRG", stored last (release) by the creator
+ *     4  u32 version      shared_ring_version
+ *     8  u64 capacity     slots, a power of two >= 2
+ *    16  u64 slot_size    bytes per slot, what both sides push and pop
+ *   128  u64 producer     items pushed since creation, atomic
+ *   256  u64 consumer     items popped since creation, atomic
+ *   384  slots            capacity * slot_size bytes, slot i at 384 + (i & (capacity - 1)) * slot_size
+ *
+ * Full is producer - consumer == capacity, empty is producer == consumer.
+ * The producer writes a slot then stores producer with release; the
+ * consumer loads producer with acquire, reads the slot, then stores
+ * consumer with release. Cursor caches are kept by each side in its own
+ * process, never in the region. The 128-byte spacing is fixed rather than
+ * CACHE_LINE (Zig uses 128 on x86-64), so both builds agree on it. */
+inline constexpr uint32_t shared_ring_magic = 0x47525053; /* "SPRG" */
+inline constexpr uint32_t shared_ring_version = 1;
+inline constexpr size_t shared_ring_line = 128;
+inline constexpr size_t shared_ring_producer_offset = 1 * shared_ring_line;
+inline constexpr size_t shared_ring_consumer_offset = 2 * shared_ring_line;
+inline constexpr size_t shared_ring_slots_offset = 3 * shared_ring_line;
+
+struct SharedRingHeader {
+    std::atomic<uint32_t> magic;
+    uint32_t version;
+    uint64_t capacity;
+    uint64_t slot_size;
+};
+
+static_assert(std::is_standard_layout<SharedRingHeader>::value && sizeof(SharedRingHeader) == 24
+              && offsetof(SharedRingHeader, version) == 4 && offsetof(SharedRingHeader, capacity) == 8
+              && offsetof(SharedRingHeader, slot_size) == 16,
+              "SharedRingHeader must match the documented layout");
+static_assert(sizeof(std::atomic<uint64_t>) == 8 && std::atomic<uint64_t>::is_always_lock_free
+              && sizeof(std::atomic<uint32_t>) == 4 && std::atomic<uint32_t>::is_always_lock_free,
+              "shared ring cursors must be plain lock-free words");
+
+/* One side's handle on a shared ring: the region plus that side's cursor
+ * cache. The producer and the consumer each attach their own handle, in
+ * the same process or not, in C++ or in Zig. */
+class SharedRing {
+private:
+    unsigned char* base = nullptr;
+    uint64_t mask = 0;
+    uint64_t slot_size = 0;
+    uint64_t push_cursor_cache = 0;
+    uint64_t pop_cursor_cache = 0;
+
+    SharedRing(void* region, uint64_t capacity, uint64_t slot_size_)
+        : base(static_cast<unsigned char*>(region)), mask(capacity - 1), slot_size(slot_size_) {}
+
+    inline __attribute__((always_inline)) SharedRingHeader&
+    header() const noexcept {
+        return *reinterpret_cast<SharedRingHeader*>(base);
+    }
+
+    inline __attribute__((always_inline)) std::atomic<uint64_t>&
+    producer() const noexcept {
+        return *reinterpret_cast<std::atomic<uint64_t>*>(base + shared_ring_producer_offset);
+    }
+
+    inline __attribute__((always_inline)) std::atomic<uint64_t>&
+    consumer() const noexcept {
+        return *reinterpret_cast<std::atomic<uint64_t>*>(base + shared_ring_consumer_offset);
+    }
+
+    inline __attribute__((always_inline)) unsigned char*
+    slot(uint64_t cursor) const noexcept {
+        return base + shared_ring_slots_offset + (cursor & mask) * slot_size;
+    }
+
+    /* why capacity slots of slot_size bytes can't live in size bytes, nullptr if they can;
+     * attach() runs it on the header too, which the other process wrote */
+    static const char*
+    geometryError(uint64_t capacity, uint64_t slot_size, size_t size) noexcept {
+        if (capacity < 2 || (capacity & (capacity - 1)) != 0) return "shared ring capacity must be a power of two >= 2";
+        if (slot_size == 0) return "shared ring slot size must not be 0";
+        size_t const needed = regionSize(capacity, slot_size);
+        if (needed == 0) return "shared ring size overflows";
+        if (size < needed) return "shared ring region is too small";
+        return nullptr;
+    }
+
+public:
+    SharedRing() = default;
+
+    /* Bytes a region holding capacity slots of slot_size bytes needs, 0 if that overflows size_t. */
+    [[nodiscard]] static constexpr size_t
+    regionSize(uint64_t capacity, uint64_t slot_size) noexcept {
+        size_t bytes = 0;
+        if (__builtin_mul_overflow(capacity, slot_size, &bytes)
+            || __builtin_add_overflow(bytes, shared_ring_slots_offset, &bytes)) {
+            return 0;
+        }
+        return bytes;
+    }
+
+    /* Initializes a zeroed or reused region of at least regionSize() bytes. */
+    [[nodiscard]] static SharedRing
+    create(void* region, size_t size, uint64_t capacity, uint64_t slot_size) {
+        if (reinterpret_cast<uintptr_t>(region) % shared_ring_line != 0)
+            throw std::invalid_argument("shared ring region must be 128-byte aligned");
+        if (const char* error = geometryError(capacity, slot_size, size)) throw std::invalid_argument(error);
+
+        SharedRing ring(region, capacity, slot_size);
+        auto* header = ::new (region) SharedRingHeader{{0}, shared_ring_version, capacity, slot_size};
+        ::new (&ring.producer()) std::atomic<uint64_t>(0);
+        ::new (&ring.consumer()) std::atomic<uint64_t>(0);
+        header->magic.store(shared_ring_magic, std::memory_order_release);
+        return ring;
+    }
+
+    /* Attaches to a region initialized by create() on either side, checking
+     * its version, its slot size and that its capacity fits in size bytes. */
+    [[nodiscard]] static SharedRing
+    attach(void* region, size_t size, uint64_t slot_size) {
+        if (reinterpret_cast<uintptr_t>(region) % shared_ring_line != 0)
+            throw std::invalid_argument("shared ring region must be 128-byte aligned");
+        if (size < shared_ring_slots_offset) throw std::runtime_error("shared ring region is too small");
+
+        auto const& header = *static_cast<const SharedRingHeader*>(region);
+        if (header.magic.load(std::memory_order_acquire) != shared_ring_magic)
+            throw std::runtime_error("shared ring is not initialized");
+        if (header.version != shared_ring_version)
+            throw std::runtime_error("shared ring layout version mismatch");
+        if (header.slot_size != slot_size) throw std::runtime_error("shared ring slot size mismatch");
+        if (const char* error = geometryError(header.capacity, header.slot_size, size)) throw std::runtime_error(error);
+        return SharedRing(region, header.capacity, header.slot_size);
+    }
+
+    /* Copies slotSize() bytes from value into the ring, false if it is full. */
+    [[nodiscard]] inline bool
+    tryPush(const void* value) noexcept {
+        uint64_t const index = producer().load(std::memory_order_relaxed);
+        if (index - push_cursor_cache == mask + 1) {
+            push_cursor_cache = consumer().load(std::memory_order_acquire);
+            if (index - push_cursor_cache == mask + 1) return false;
+        }
+
+        std::memcpy(slot(index), value, slot_size);
+        producer().store(index + 1, std::memory_order_release);
+        return true;
+    }
+
+    /* Copies the oldest slot into value, false if the ring is empty. */
+    [[nodiscard]] inline bool
+    tryPop(void* value) noexcept {
+        uint64_t const index = consumer().load(std::memory_order_relaxed);
+        if (index == pop_cursor_cache) {
+            pop_cursor_cache = producer().load(std::memory_order_acquire);
+            if (index == pop_cursor_cache) return false;
+        }
+
+        std::memcpy(value, slot(index), slot_size);
+        consumer().store(index + 1, std::memory_order_release);
+        return true;
+    }
+
+    inline void
+    push(const void* value) noexcept {
+        while (!tryPush(value)) spinLoopHint();
+    }
+
+    inline void
+    pop(void* value) noexcept {
+        while (!tryPop(value)) spinLoopHint();
+    }
+
+    template<typename T> [[nodiscard]] inline bool
+    tryPush(const T& value) noexcept {
+        static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+        assert(sizeof(T) == slot_size);
+        return tryPush(static_cast<const void*>(&value));
+    }
+
+    template<typename T> [[nodiscard]] inline bool
+    tryPop(T& value) noexcept {
+        static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+        assert(sizeof(T) == slot_size);
+        return tryPop(static_cast<void*>(&value));
+    }
+
+    [[nodiscard]] inline uint64_t
+    capacity() const noexcept {
+        return mask + 1;
+    }
+
+    [[nodiscard]] inline uint64_t
+    slotSize() const noexcept {
+        return slot_size;
+    }
+
+    [[nodiscard]] inline uint64_t
+    count() const noexcept {
+        uint64_t const read_index = consumer().load(std::memory_order_acquire);
+        uint64_t const write_index = producer().load(std::memory_order_acquire);
+        return write_index - read_index;
+    }
+};
@@ -0,0 +1,90 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) Andrea Vaccaro
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Source: https://github.com/ANDRVV/SPSCQueue
+ * C entry points over SharedRing. Build it into the C, C++ or Zig program
+ * that doesn't use shared_ring.hpp directly:
+ *   g++ -c src/cpp/spsc_ring.cpp -O3 -o spsc_ring.o
+ */
+
+#include "spsc_ring.h"
+
+#include <exception>
+
+#include "shared_ring.hpp"
+
+struct spsc_ring {
+    SharedRing ring;
+};
+
+extern "C" {
+
+size_t
+spsc_ring_region_size(uint64_t capacity, uint64_t slot_size) {
+    return SharedRing::regionSize(capacity, slot_size);
+}
+
+spsc_ring*
+spsc_ring_create(void* region, size_t size, uint64_t capacity, uint64_t slot_size) {
+    try {
+        return new spsc_ring{SharedRing::create(region, size, capacity, slot_size)};
+    } catch (const std::exception&) {
+        return nullptr;
+    }
+}
+
+spsc_ring*
+spsc_ring_attach(void* region, size_t size, uint64_t slot_size) {
+    try {
+        return new spsc_ring{SharedRing::attach(region, size, slot_size)};
+    } catch (const std::exception&) {
+        return nullptr;
+    }
+}
+
+void
+spsc_ring_release(spsc_ring* ring) {
+    delete ring;
+}
+
+int
+spsc_ring_try_push(spsc_ring* ring, const void* value) {
+    return ring->ring.tryPush(value) ? 1 : 0;
+}
+
+int
+spsc_ring_try_pop(spsc_ring* ring, void* value) {
+    return ring->ring.tryPop(value) ? 1 : 0;
+}
+
+uint64_t
+spsc_ring_capacity(const spsc_ring* ring) {
+    return ring->ring.capacity();
+}
+
+uint64_t
+spsc_ring_count(const spsc_ring* ring) {
+    return ring->ring.count();
+}
+
+}
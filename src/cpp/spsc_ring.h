@@ -0,0 +1,69 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) Andrea Vaccaro
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Source: https://github.com/ANDRVV/SPSCQueue
+ * C entry points over SharedRing (shared_ring.hpp), defined in spsc_ring.cpp.
+ * The region layout is documented in shared_ring.hpp and implemented
+ * natively by SharedRing in queue.zig, so either side of a ring may use
+ * this API, the C++ class or the Zig struct.
+ */
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* One side's handle: the region plus that side's cursor cache. */
+typedef struct spsc_ring spsc_ring;
+
+/* Bytes a region for capacity slots of slot_size bytes needs, 0 if that overflows size_t. */
+size_t spsc_ring_region_size(uint64_t capacity, uint64_t slot_size);
+
+/* Initializes region (128-byte aligned, size bytes) and returns a handle,
+ * NULL on a bad argument or allocation failure. */
+spsc_ring* spsc_ring_create(void* region, size_t size, uint64_t capacity, uint64_t slot_size);
+
+/* Attaches to an initialized region, NULL if it isn't one, its slot size differs
+ * or the capacity in its header doesn't fit in size bytes. */
+spsc_ring* spsc_ring_attach(void* region, size_t size, uint64_t slot_size);
+
+/* Frees the handle; the region and the ring in it are left untouched. */
+void spsc_ring_release(spsc_ring* ring);
+
+/* Each copies slot_size bytes and returns 1, or returns 0 if the ring is full (empty). */
+int spsc_ring_try_push(spsc_ring* ring, const void* value);
+int spsc_ring_try_pop(spsc_ring* ring, void* value);
+
+uint64_t spsc_ring_capacity(const spsc_ring* ring);
+uint64_t spsc_ring_count(const spsc_ring* ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
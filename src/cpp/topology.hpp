@@ -0,0 +1,220 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) Andrea Vaccaro
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Source: https://github.com/ANDRVV/SPSCQueue
+ * CPU topology discovery and producer/consumer core placement (Linux sysfs).
+ */
+
+#pragma once
+
+#include <sched.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+/* How far apart two CPUs are, from the closest to the farthest.
+ * Their shared cache bounds the cost of a cache line ping-ponging
+ * between producer and consumer, so the class predicts the RTT. */
+enum class Placement {
+    smt,          /* hardware threads of the same core: L1 and L2 shared */
+    l2,           /* different cores sharing an L2 (e.g. an E-core cluster) */
+    l3,           /* different L2s sharing an L3 */
+    cross_l3,     /* same package, different L3 (e.g. AMD CCXs) */
+    cross_socket, /* different packages */
+};
+
+[[nodiscard]] inline const char*
+placementName(Placement placement) noexcept {
+    switch (placement) {
+        case Placement::smt:          return "smt";
+        case Placement::l2:           return "l2";
+        case Placement::l3:           return "l3";
+        case Placement::cross_l3:     return "cross-l3";
+        case Placement::cross_socket: return "cross-socket";
+    }
+    return "unknown";
+}
+
+/* A CPU as the scheduler sees it. Cache and core groups are
+ * identified by the lowest CPU number sharing them, -1 if unknown. */
+struct CpuInfo {
+    size_t cpu;
+    int package = -1;
+    int core = -1; /* lowest SMT sibling */
+    int l2 = -1;
+    int l3 = -1;
+    bool efficiency = false; /* E-core of a hybrid CPU */
+};
+
+struct CpuPair {
+    size_t producer;
+    size_t consumer;
+    Placement placement;
+};
+
+/* Parses a sysfs CPU list such as "0-3,8,10-11". */
+[[nodiscard]] inline std::vector<size_t>
+parseCpuList(const std::string& list) {
+    std::vector<size_t> cpus;
+    for (const char* p = list.c_str(); *p != '\0' && *p != '\n';) {
+        char* end;
+        size_t const first = std::strtoull(p, &end, 10);
+        if (end == p) break;
+        size_t last = first;
+        if (*end == '-') {
+            p = end + 1;
+            last = std::strtoull(p, &end, 10);
+        }
+        for (size_t cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+        p = *end == ',' ? end + 1 : end;
+    }
+    return cpus;
+}
+
+/* first line of a sysfs file, empty if it can't be read */
+[[nodiscard]] inline std::string
+readSysfsLine(const std::string& path) {
+    std::string line;
+    if (std::FILE* file = std::fopen(path.c_str(), "r")) {
+        char buffer[4096];
+        if (std::fgets(buffer, sizeof(buffer), file) != nullptr) line = buffer;
+        std::fclose(file);
+        while (!line.empty() && (line.back() == '\n' || line.back() == ' ')) line.pop_back();
+    }
+    return line;
+}
+
+[[nodiscard]] inline int
+lowestCpuOf(const std::string& list) {
+    std::vector<size_t> const cpus = parseCpuList(list);
+    return cpus.empty() ? -1 : static_cast<int>(*std::min_element(cpus.begin(), cpus.end()));
+}
+
+/* Reads the topology of the online CPUs the calling thread may run on,
+ * sorted by CPU number. root is the sysfs CPU directory, replaceable for
+ * tests. Empty if sysfs can't be read or the platform isn't Linux. */
+[[nodiscard]] inline std::vector<CpuInfo>
+readCpuTopology(const std::string& root = "/sys/devices/system/cpu") {
+    std::vector<CpuInfo> cpus;
+#ifdef __linux__
+    cpu_set_t allowed;
+    bool const has_affinity = root == "/sys/devices/system/cpu" && sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+
+    /* Intel hybrid parts list their E-cores here */
+    std::vector<size_t> const atoms = parseCpuList(readSysfsLine(root + "/../../cpu_atom/cpus"));
+
+    for (size_t cpu : parseCpuList(readSysfsLine(root + "/online"))) {
+        if (has_affinity && (cpu >= CPU_SETSIZE || !CPU_ISSET(cpu, &allowed))) continue;
+        std::string const dir = root + "/cpu" + std::to_string(cpu);
+
+        CpuInfo info{cpu};
+        std::string const package = readSysfsLine(dir + "/topology/physical_package_id");
+        if (!package.empty()) info.package = std::atoi(package.c_str());
+        info.core = lowestCpuOf(readSysfsLine(dir + "/topology/thread_siblings_list"));
+        if (info.core < 0) info.core = static_cast<int>(cpu);
+
+        for (unsigned index = 0;; ++index) {
+            std::string const cache = dir + "/cache/index" + std::to_string(index);
+            std::string const level = readSysfsLine(cache + "/level");
+            if (level.empty()) break;
+            if (readSysfsLine(cache + "/type") == "Instruction") continue;
+            int const group = lowestCpuOf(readSysfsLine(cache + "/shared_cpu_list"));
+            if (level == "2") info.l2 = group;
+            if (level == "3") info.l3 = group;
+        }
+
+        info.efficiency = std::find(atoms.begin(), atoms.end(), cpu) != atoms.end();
+        if (!info.efficiency) {
+            /* Arm big.LITTLE: little cores report a capacity below 1024 */
+            std::string const capacity = readSysfsLine(dir + "/cpu_capacity");
+            info.efficiency = !capacity.empty() && std::atoi(capacity.c_str()) < 1024;
+        }
+        cpus.push_back(info);
+    }
+#else
+    (void)root;
+#endif
+    return cpus;
+}
+
+[[nodiscard]] inline Placement
+placementOf(const CpuInfo& a, const CpuInfo& b) noexcept {
+    if (a.package != b.package) return Placement::cross_socket;
+    if (a.core == b.core) return Placement::smt;
+    if (a.l2 >= 0 && a.l2 == b.l2) return Placement::l2;
+    if (a.l3 >= 0 && a.l3 == b.l3) return Placement::l3;
+    return Placement::cross_l3;
+}
+
+/* One pair of CPUs per placement class present, closest class first,
+ * preferring performance cores: what a benchmark sweep should cover. */
+[[nodiscard]] inline std::vector<CpuPair>
+representativePairs(const std::vector<CpuInfo>& cpus) {
+    std::vector<CpuPair> pairs;
+    for (bool efficiency : {false, true}) {
+        for (const CpuInfo& a : cpus) {
+            for (const CpuInfo& b : cpus) {
+                if (a.cpu == b.cpu || a.efficiency != efficiency || b.efficiency != efficiency) continue;
+                Placement const placement = placementOf(a, b);
+                bool const seen = std::any_of(pairs.begin(), pairs.end(),
+                                              [&](const CpuPair& p) { return p.placement == placement; });
+                if (!seen) pairs.push_back({a.cpu, b.cpu, placement});
+            }
+        }
+    }
+    std::stable_sort(pairs.begin(), pairs.end(),
+                     [](const CpuPair& x, const CpuPair& y) { return x.placement < y.placement; });
+    return pairs;
+}
+
+/* Suggests up to count disjoint producer/consumer pairs on distinct
+ * physical cores sharing an L2, then an L3, performance cores first.
+ * SMT siblings of a used CPU are never handed out, so each endpoint
+ * keeps its core to itself. Closest pairs come first. */
+[[nodiscard]] inline std::vector<CpuPair>
+suggestCorePairs(const std::vector<CpuInfo>& cpus, size_t count) {
+    std::vector<CpuPair> pairs;
+    std::vector<int> used_cores;
+    auto const is_free = [&](const CpuInfo& info) {
+        return std::find(used_cores.begin(), used_cores.end(), info.core) == used_cores.end();
+    };
+
+    for (Placement wanted : {Placement::l2, Placement::l3}) {
+        for (bool efficiency : {false, true}) {
+            for (const CpuInfo& a : cpus) {
+                for (const CpuInfo& b : cpus) {
+                    if (pairs.size() == count) return pairs;
+                    if (a.efficiency != efficiency || b.efficiency != efficiency) continue;
+                    if (!is_free(a) || !is_free(b) || placementOf(a, b) != wanted) continue;
+                    pairs.push_back({a.cpu, b.cpu, wanted});
+                    used_cores.push_back(a.core);
+                    used_cores.push_back(b.core);
+                }
+            }
+        }
+    }
+    return pairs;
+}
@@ -0,0 +1,262 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) Andrea Vaccaro
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Source: https://github.com/ANDRVV/SPSCQueue
+ * SPSCQueue wrapper sampling how long items wait between push and pop.
+ */
+
+#pragma once
+
+#include "histogram_buckets.hpp"
+#include "queue.hpp"
+#include "tsc.hpp"
+
+/* Lock-free histogram of dwell times in cycle counter ticks, bucketed
+ * like the benchmark's Histogram (histogram_buckets.hpp). Only the consumer
+ * records, with plain loads and stores instead of locked read-modify-writes,
+ * so a monitoring thread can read it at any time without slowing the
+ * consumer down; what it reads is each counter as of some recent moment. */
+class DwellHistogram {
+private:
+    using Buckets = LogLinearBuckets<>;
+
+    std::atomic<uint64_t> counts[Buckets::count] = {};
+    alignas(CACHE_LINE) std::atomic<uint64_t> largest{0};
+    std::atomic<uint64_t> sum{0};
+
+public:
+    inline __attribute__((always_inline)) void
+    record(uint64_t ticks) noexcept {
+        std::atomic<uint64_t>& bucket = counts[Buckets::bucketOf(ticks)];
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        sum.store(sum.load(std::memory_order_relaxed) + ticks, std::memory_order_relaxed);
+        if (ticks > largest.load(std::memory_order_relaxed)) largest.store(ticks, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] uint64_t
+    count() const noexcept {
+        uint64_t total = 0;
+        for (size_t i = 0; i < Buckets::count; ++i) total += counts[i].load(std::memory_order_relaxed);
+        return total;
+    }
+
+    /* Returns the dwell time at percentile p in [0, 100], in ticks. */
+    [[nodiscard]] uint64_t
+    percentile(double p) const noexcept {
+        uint64_t const total = count();
+        if (total == 0) return 0;
+        uint64_t const top = max();
+        uint64_t const rank = std::max<uint64_t>(1, static_cast<uint64_t>(p / 100.0 * total + 0.5));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < Buckets::count; ++i) {
+            seen += counts[i].load(std::memory_order_relaxed);
+            if (seen >= rank) return std::min(Buckets::valueOf(i), top);
+        }
+        return top;
+    }
+
+    [[nodiscard]] uint64_t
+    max() const noexcept {
+        return largest.load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] double
+    mean() const noexcept {
+        uint64_t const total = count();
+        return total ? static_cast<double>(sum.load(std::memory_order_relaxed)) / static_cast<double>(total) : 0.0;
+    }
+};
+
+/* An item and the cycle counter reading taken when it was pushed, 0 if it wasn't sampled. */
+template<typename T>
+struct TracedSlot {
+    T value;
+    uint64_t stamp;
+
+    template<typename... Args>
+    explicit TracedSlot(uint64_t stamp_, Args&&... args) : value(std::forward<Args>(args)...), stamp(stamp_) {}
+};
+
+/* TracedSPSCQueue's sampling state, each side's part on its own cache line. */
+template<bool Tracing>
+struct TraceState {
+    /* producer private */
+    alignas(CACHE_LINE) size_t push_count = 0;
+    /* consumer private, readable by any thread */
+    alignas(CACHE_LINE) DwellHistogram dwell;
+};
+
+/* tracing off: nothing to keep */
+template<>
+struct TraceState<false> {};
+
+/* SPSCQueue recording how long items sit in it. Every SampleEvery-th push
+ * stores a cycle counter reading next to the item; popping a stamped item
+ * reads the counter again and records the difference in histogram(), and
+ * pop() and tryPop() also hand it to the caller. Unsampled items cost a
+ * counter increment on the producer and a branch on the consumer, with no
+ * counter reads. SampleEvery = 0 turns tracing off at compile time: slots
+ * are plain T, the wrapper forwards straight to the ring and is the size
+ * of it, and histogram() is not available.
+ *
+ * Dwell times are in ticks (tscTicksPerNs() converts them) and include
+ * time spent in unpublished producer batches. They assume the counter is
+ * synchronized across cores, as invariant TSCs are; a reading earlier
+ * than the stamp counts as 0. */
+template<typename T, size_t N = dynamic_slots, typename Traits = DefaultQueueTraits, size_t SampleEvery = 64>
+class TracedSPSCQueue {
+    static_assert(SampleEvery == 0 || (SampleEvery & (SampleEvery - 1)) == 0,
+                  "SampleEvery must be 0 or a power of two");
+
+public:
+    static constexpr bool tracing = SampleEvery != 0;
+    using Slot = std::conditional_t<tracing, TracedSlot<T>, T>;
+
+private:
+    SPSCQueue<Slot, N, Traits> ring;
+    [[no_unique_address]] TraceState<tracing> trace;
+
+    /* returns the stamp for the next push */
+    inline __attribute__((always_inline)) uint64_t
+    nextStamp() noexcept {
+        return ((trace.push_count + 1) & (SampleEvery - 1)) == 0 ? readTsc() : 0;
+    }
+
+    /* records slot's dwell time if it was sampled, returns it or 0 */
+    inline __attribute__((always_inline)) uint64_t
+    finish(const Slot& slot) noexcept {
+        if constexpr (tracing) {
+            if (__builtin_expect(slot.stamp != 0, 0)) {
+                uint64_t const now = readTscp();
+                uint64_t const ticks = now > slot.stamp ? now - slot.stamp : 0;
+                trace.dwell.record(ticks);
+                return ticks;
+            }
+        }
+        return 0;
+    }
+
+    static inline __attribute__((always_inline)) T&
+    valueOf(Slot& slot) noexcept {
+        if constexpr (tracing) return slot.value;
+        else return slot;
+    }
+
+public:
+    template<size_t M = N, typename = std::enable_if_t<M == dynamic_slots>>
+    explicit TracedSPSCQueue(size_t slots_, const SlotAllocation& alloc = {}) : ring(slots_, alloc) {}
+
+    template<size_t M = N, typename = std::enable_if_t<M != dynamic_slots>>
+    TracedSPSCQueue() {}
+
+    TracedSPSCQueue(const TracedSPSCQueue&) = delete;
+    TracedSPSCQueue& operator=(const TracedSPSCQueue&) = delete;
+
+    template<typename... Args> inline void
+    emplace(Args&&... args) {
+        if constexpr (tracing) {
+            ring.emplace(nextStamp(), std::forward<Args>(args)...);
+            ++trace.push_count;
+        } else {
+            ring.emplace(std::forward<Args>(args)...);
+        }
+    }
+
+    template<typename... Args> [[nodiscard]] inline bool
+    tryEmplace(Args&&... args) {
+        if constexpr (tracing) {
+            if (!ring.tryEmplace(nextStamp(), std::forward<Args>(args)...)) return false;
+            ++trace.push_count;
+            return true;
+        } else {
+            return ring.tryEmplace(std::forward<Args>(args)...);
+        }
+    }
+
+    inline void
+    push(const T& value) {
+        emplace(value);
+    }
+
+    inline void
+    push(T&& value) {
+        emplace(std::move(value));
+    }
+
+    [[nodiscard]] inline bool
+    tryPush(const T& value) {
+        return tryEmplace(value);
+    }
+
+    [[nodiscard]] inline bool
+    tryPush(T&& value) {
+        return tryEmplace(std::move(value));
+    }
+
+    /* Waits for an item. Stores its dwell time in ticks in dwell_ticks
+     * when given, 0 if it wasn't sampled. */
+    [[nodiscard]] inline T
+    pop(uint64_t* dwell_ticks = nullptr) {
+        Slot slot = ring.pop();
+        uint64_t const ticks = finish(slot);
+        if (dwell_ticks != nullptr) *dwell_ticks = ticks;
+        return std::move(valueOf(slot));
+    }
+
+    [[nodiscard]] inline bool
+    tryPop(T& out, uint64_t* dwell_ticks = nullptr) {
+        Slot* slot = ring.frontMutable();
+        if (slot == nullptr) return false;
+        uint64_t const ticks = finish(*slot);
+        out = std::move(valueOf(*slot));
+        ring.popFront();
+        if (dwell_ticks != nullptr) *dwell_ticks = ticks;
+        return true;
+    }
+
+    inline void
+    flushProducer() noexcept {
+        ring.flushProducer();
+    }
+
+    inline void
+    flushConsumer() noexcept {
+        ring.flushConsumer();
+    }
+
+    /* Sampled dwell times so far; safe to read from any thread. Only with tracing on. */
+    template<bool B = tracing, typename = std::enable_if_t<B>> [[nodiscard]] inline const DwellHistogram&
+    histogram() const noexcept {
+        return trace.dwell;
+    }
+
+    [[nodiscard]] inline size_t
+    count() const noexcept {
+        return ring.count();
+    }
+
+    [[nodiscard]] inline bool
+    isEmpty() const noexcept {
+        return ring.isEmpty();
+    }
+};
@@ -0,0 +1,78 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) Andrea Vaccaro
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Source: https://github.com/ANDRVV/SPSCQueue
+ * Cycle counter access and calibration.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#if defined(__x86_64__) || defined(_M_X64)
+    #include <x86intrin.h>
+#endif
+
+/* Reads the cycle counter at the start of a measured region. */
+inline __attribute__((always_inline)) uint64_t
+readTsc() noexcept {
+#if defined(__x86_64__) || defined(_M_X64)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t ticks;
+    asm volatile("isb; mrs %0, cntvct_el0" : "=r"(ticks) :: "memory");
+    return ticks;
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+/* Reads the cycle counter at the end of a measured region, after
+ * every preceding instruction has completed. */
+inline __attribute__((always_inline)) uint64_t
+readTscp() noexcept {
+#if defined(__x86_64__) || defined(_M_X64)
+    unsigned aux;
+    return __rdtscp(&aux);
+#else
+    return readTsc();
+#endif
+}
+
+/* Returns cycle counter ticks per nanosecond, measured once against steady_clock. */
+[[nodiscard]] inline double
+tscTicksPerNs() {
+    static double const ticks_per_ns = [] {
+        auto const start = std::chrono::steady_clock::now();
+        uint64_t const ticks = readTsc();
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        uint64_t const elapsed_ticks = readTscp() - ticks;
+        auto const elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start);
+        return static_cast<double>(elapsed_ticks) / static_cast<double>(elapsed.count());
+    }();
+    return ticks_per_ns;
+}
@@ -0,0 +1,95 @@
+//! MIT License
+//!
+//! Copyright (c) Andrea Vaccaro
+//!
+//! Permission is hereby granted, free of charge, to any person obtaining a copy
+//! of this software and associated documentation files (the "Software"), to deal
+//! in the Software without restriction, including without limitation the rights
+//! to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//! copies of the Software, and to permit persons to whom the Software is
+//! furnished to do so, subject to the following conditions:
+//!
+//! The above copyright notice and this permission notice shall be included in all
+//! copies or substantial portions of the Software.
+//!
+//! THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//! IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//! FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//! AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//! LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//! OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//! SOFTWARE.
+//!
+//! Source: https://github.com/ANDRVV/SPSCQueue
+//! C ABI over SPSCQueue for fixed-size byte payloads, used by the C++ comparison benchmark.
+//!
+//! For every size in `payload_sizes` it exports:
+//!   void* spsc_zig_create_<bytes>(size_t slots);
+//!   void  spsc_zig_destroy_<bytes>(void* queue);
+//!   void  spsc_zig_push_<bytes>(void* queue, const void* value);
+//!   void  spsc_zig_pop_<bytes>(void* queue, void* value);
+
+const std = @import("std");
+
+const SPSCQueue = @import("queue.zig").SPSCQueue;
+
+const allocator = std.heap.page_allocator;
+
+/// Payload sizes compiled into the library, matching the C++ benchmark.
+pub const payload_sizes = [_]usize{ 8, 16, 32, 64, 128, 256, 512, 1024 };
+
+fn Exports(comptime bytes: usize) type {
+    return struct {
+        const Payload = [bytes]u8;
+        const Queue = SPSCQueue(Payload);
+
+        fn create(slots: usize) callconv(.c) ?*anyopaque {
+            const queue = allocator.create(Queue) catch return null;
+            queue.* = Queue.initCapacity(allocator, slots) catch {
+                allocator.destroy(queue);
+                return null;
+            };
+            return queue;
+        }
+
+        fn destroy(handle: *anyopaque) callconv(.c) void {
+            const queue: *Queue = @ptrCast(@alignCast(handle));
+            queue.deinit(allocator);
+            allocator.destroy(queue);
+        }
+
+        fn push(handle: *anyopaque, value: *const anyopaque) callconv(.c) void {
+            const queue: *Queue = @ptrCast(@alignCast(handle));
+            queue.push(@as(*const Payload, @ptrCast(value)).*);
+        }
+
+        fn pop(handle: *anyopaque, value: *anyopaque) callconv(.c) void {
+            const queue: *Queue = @ptrCast(@alignCast(handle));
+            @as(*Payload, @ptrCast(value)).* = queue.pop();
+        }
+    };
+}
+
+comptime {
+    for (payload_sizes) |bytes| {
+        const api = Exports(bytes);
+        @export(&api.create, .{ .name = std.fmt.comptimePrint("spsc_zig_create_{d}", .{bytes}) });
+        @export(&api.destroy, .{ .name = std.fmt.comptimePrint("spsc_zig_destroy_{d}", .{bytes}) });
+        @export(&api.push, .{ .name = std.fmt.comptimePrint("spsc_zig_push_{d}", .{bytes}) });
+        @export(&api.pop, .{ .name = std.fmt.comptimePrint("spsc_zig_pop_{d}", .{bytes}) });
+    }
+}
+
+test "c abi round trip" {
+    const api = Exports(16);
+    const queue = api.create(64) orelse return error.OutOfMemory;
+    defer api.destroy(queue);
+
+    for (0..100) |i| {
+        var in: api.Payload = @splat(@intCast(i));
+        var out: api.Payload = undefined;
+        api.push(queue, &in);
+        api.pop(queue, &out);
+        try std.testing.expectEqualSlices(u8, &in, &out);
+    }
+}
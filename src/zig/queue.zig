@@ -43,7 +43,9 @@ pub fn SPSCQueue(comptime T: type) type {
         items: []T,
         mask: usize,
         // producer and consumer are aligned to cache line
-        // size in order to avoid false sharing
+        // size in order to avoid false sharing. They count items
+        // pushed and popped and are only masked to address a slot,
+        // so every slot is usable
         producer: Atomic(usize) align(cache_line) = .init(0),
         consumer: Atomic(usize) align(cache_line) = .init(0),
 
@@ -68,29 +70,27 @@ pub fn SPSCQueue(comptime T: type) type {
         pub fn push(self: *Self, value: T) void {
             const index = self.producer.load(.monotonic);
 
-            const next = self.nextIndex(index);
-            while (next == self.push_cursor_cache) {
+            while (index -% self.push_cursor_cache == self.items.len) {
                 // in this line, spinLoopHint is commented out assuming the consumer is more hot
                 // than the producer. Uncomment this line if the producer has more throughput.
                 // std.atomic.spinLoopHint();
                 self.push_cursor_cache = self.consumer.load(.acquire);
             }
 
-            self.items[index] = value;
-            self.producer.store(next, .release);
+            self.items[index & self.mask] = value;
+            self.producer.store(index +% 1, .release);
         }
 
         pub fn tryPush(self: *Self, value: T) bool {
             const index = self.producer.load(.monotonic);
 
-            const next = self.nextIndex(index);
-            if (next == self.push_cursor_cache) {
+            if (index -% self.push_cursor_cache == self.items.len) {
                 self.push_cursor_cache = self.consumer.load(.acquire);
-                if (next == self.push_cursor_cache) return false;
+                if (index -% self.push_cursor_cache == self.items.len) return false;
             }
 
-            self.items[index] = value;
-            self.producer.store(next, .release);
+            self.items[index & self.mask] = value;
+            self.producer.store(index +% 1, .release);
             return true;
         }
 
@@ -101,8 +101,10 @@ pub fn SPSCQueue(comptime T: type) type {
                 self.pop_cursor_cache = self.producer.load(.acquire);
             }
 
-            self.consumer.store(self.nextIndex(index), .release);
-            return self.items[index];
+            // read the slot before releasing it to the producer
+            const value = self.items[index & self.mask];
+            self.consumer.store(index +% 1, .release);
+            return value;
         }
 
         pub fn tryPop(self: *Self) ?T {
@@ -112,14 +114,16 @@ pub fn SPSCQueue(comptime T: type) type {
                 if (index == self.pop_cursor_cache) return null;
             }
 
-            self.consumer.store(self.nextIndex(index), .release);
-            return self.items[index];
+            // read the slot before releasing it to the producer
+            const value = self.items[index & self.mask];
+            self.consumer.store(index +% 1, .release);
+            return value;
         }
 
         pub fn count(self: *Self) usize {
             const write_index = self.producer.load(.acquire);
             const read_index = self.consumer.load(.acquire);
-            return (write_index - read_index) & self.mask;
+            return write_index -% read_index;
         }
 
         pub fn isEmpty(self: *Self) bool {
@@ -127,13 +131,159 @@ pub fn SPSCQueue(comptime T: type) type {
             const read_index = self.consumer.load(.acquire);
             return write_index == read_index;
         }
-
-        inline fn nextIndex(self: *const Self, i: usize) usize {
-            return (i + 1) & self.mask;
-        }
     };
 }
 
+/// Binary layout of a ring shared with C++ (`SharedRing` in src/cpp/shared_ring.hpp),
+/// version 1. Offsets are from the 128-byte aligned region start:
+///     0  u32 magic      "SPRG", stored last (release) by the creator
+///     4  u32 version
+///     8  u64 capacity   slots, a power of two >= 2
+///    16  u64 slot_size  bytes per slot
+///   128  u64 producer   items pushed since creation, atomic
+///   256  u64 consumer   items popped since creation, atomic
+///   384  slots          slot i at 384 + (i & (capacity - 1)) * slot_size
+/// The spacing is fixed at 128 bytes whatever `cache_line` is, so both builds agree.
+pub const shared_ring = struct {
+    pub const magic: u32 = 0x47525053;
+    pub const version: u32 = 1;
+    pub const line = 128;
+    pub const producer_offset = 1 * line;
+    pub const consumer_offset = 2 * line;
+    pub const slots_offset = 3 * line;
+};
+
+const SharedRingHeader = extern struct {
+    magic: u32,
+    version: u32,
+    capacity: u64,
+    slot_size: u64,
+};
+
+comptime {
+    std.debug.assert(@sizeOf(SharedRingHeader) == 24);
+    std.debug.assert(@offsetOf(SharedRingHeader, "version") == 4);
+    std.debug.assert(@offsetOf(SharedRingHeader, "capacity") == 8);
+    std.debug.assert(@offsetOf(SharedRingHeader, "slot_size") == 16);
+}
+
+/// One side's handle on a shared ring of fixed-size byte slots, usable from
+/// a different process or language than the other side. Cursor caches stay
+/// in the handle, never in the region.
+pub const SharedRing = struct {
+    base: [*]u8,
+    mask: u64,
+    slot_size: u64,
+    push_cursor_cache: u64 = 0,
+    pop_cursor_cache: u64 = 0,
+
+    pub const Error = error{
+        Misaligned,
+        InvalidCapacity,
+        RegionTooSmall,
+        SizeOverflow,
+        NotInitialized,
+        VersionMismatch,
+        SlotSizeMismatch,
+    };
+
+    /// Returns the bytes a region for capacity slots of slot_size bytes needs, null if that overflows.
+    pub fn regionSize(capacity: u64, slot_size: u64) ?usize {
+        const slots = std.math.mul(u64, capacity, slot_size) catch return null;
+        const total = std.math.add(u64, slots, shared_ring.slots_offset) catch return null;
+        return std.math.cast(usize, total);
+    }
+
+    /// Checks that capacity slots of slot_size bytes fit in len bytes; attach
+    /// runs it on the header too, as the other process wrote it.
+    fn checkGeometry(capacity: u64, slot_size: u64, len: usize) Error!void {
+        if (capacity < 2 or capacity & (capacity - 1) != 0 or slot_size == 0) return error.InvalidCapacity;
+        const needed = regionSize(capacity, slot_size) orelse return error.SizeOverflow;
+        if (len < needed) return error.RegionTooSmall;
+    }
+
+    fn header(self: SharedRing) *SharedRingHeader {
+        return @ptrCast(@alignCast(self.base));
+    }
+
+    fn cursor(self: SharedRing, comptime offset: usize) *u64 {
+        return @ptrCast(@alignCast(self.base + offset));
+    }
+
+    fn slot(self: SharedRing, index: u64) []u8 {
+        const start: usize = @intCast(shared_ring.slots_offset + (index & self.mask) * self.slot_size);
+        return self.base[start .. start + @as(usize, @intCast(self.slot_size))];
+    }
+
+    /// Initializes region and returns the creator's handle.
+    pub fn create(region: []u8, capacity: u64, slot_size: u64) Error!SharedRing {
+        if (!std.mem.isAligned(@intFromPtr(region.ptr), shared_ring.line)) return error.Misaligned;
+        try checkGeometry(capacity, slot_size, region.len);
+
+        const ring: SharedRing = .{ .base = region.ptr, .mask = capacity - 1, .slot_size = slot_size };
+        const head = ring.header();
+        @atomicStore(u32, &head.magic, 0, .monotonic);
+        head.version = shared_ring.version;
+        head.capacity = capacity;
+        head.slot_size = slot_size;
+        @atomicStore(u64, ring.cursor(shared_ring.producer_offset), 0, .monotonic);
+        @atomicStore(u64, ring.cursor(shared_ring.consumer_offset), 0, .monotonic);
+        @atomicStore(u32, &head.magic, shared_ring.magic, .release);
+        return ring;
+    }
+
+    /// Attaches to a region initialized by either side, checking version,
+    /// slot size and that the capacity in the header fits in the region.
+    pub fn attach(region: []u8, slot_size: u64) Error!SharedRing {
+        if (!std.mem.isAligned(@intFromPtr(region.ptr), shared_ring.line)) return error.Misaligned;
+        if (region.len < shared_ring.slots_offset) return error.RegionTooSmall;
+
+        const head: *SharedRingHeader = @ptrCast(@alignCast(region.ptr));
+        if (@atomicLoad(u32, &head.magic, .acquire) != shared_ring.magic) return error.NotInitialized;
+        if (head.version != shared_ring.version) return error.VersionMismatch;
+        if (head.slot_size != slot_size) return error.SlotSizeMismatch;
+        try checkGeometry(head.capacity, head.slot_size, region.len);
+        return .{ .base = region.ptr, .mask = head.capacity - 1, .slot_size = head.slot_size };
+    }
+
+    pub fn tryPush(self: *SharedRing, value: []const u8) bool {
+        std.debug.assert(value.len == self.slot_size);
+        const producer = self.cursor(shared_ring.producer_offset);
+        const index = @atomicLoad(u64, producer, .monotonic);
+
+        if (index -% self.push_cursor_cache == self.mask + 1) {
+            self.push_cursor_cache = @atomicLoad(u64, self.cursor(shared_ring.consumer_offset), .acquire);
+            if (index -% self.push_cursor_cache == self.mask + 1) return false;
+        }
+
+        @memcpy(self.slot(index), value);
+        @atomicStore(u64, producer, index +% 1, .release);
+        return true;
+    }
+
+    pub fn tryPop(self: *SharedRing, value: []u8) bool {
+        std.debug.assert(value.len == self.slot_size);
+        const consumer = self.cursor(shared_ring.consumer_offset);
+        const index = @atomicLoad(u64, consumer, .monotonic);
+
+        if (index == self.pop_cursor_cache) {
+            self.pop_cursor_cache = @atomicLoad(u64, self.cursor(shared_ring.producer_offset), .acquire);
+            if (index == self.pop_cursor_cache) return false;
+        }
+
+        // read the slot before releasing it to the producer
+        @memcpy(value, self.slot(index));
+        @atomicStore(u64, consumer, index +% 1, .release);
+        return true;
+    }
+
+    pub fn count(self: SharedRing) u64 {
+        const read_index = @atomicLoad(u64, self.cursor(shared_ring.consumer_offset), .acquire);
+        const write_index = @atomicLoad(u64, self.cursor(shared_ring.producer_offset), .acquire);
+        return write_index -% read_index;
+    }
+};
+
 const TestQueue = SPSCQueue(u64);
 
 test "spsc queue single-threaded" {
@@ -145,6 +295,18 @@ test "spsc queue single-threaded" {
     }
 }
 
+test "spsc queue uses every slot" {
+    var queue: TestQueue = try .initCapacity(std.heap.page_allocator, 8);
+    defer queue.deinit(std.heap.page_allocator);
+
+    for (0..8) |i| try std.testing.expect(queue.tryPush(i));
+    try std.testing.expect(!queue.tryPush(8));
+    try std.testing.expect(queue.count() == 8);
+
+    for (0..8) |i| try std.testing.expect(queue.tryPop().? == i);
+    try std.testing.expect(queue.isEmpty());
+}
+
 fn producerTest(queue: *TestQueue, comptime iterations: comptime_int) void {
     for (0..iterations) |i| queue.push(i);
 }
@@ -156,3 +318,80 @@ test "spsc queue multi-threaded" {
     for (0..iterations) |i| try std.testing.expect(queue.pop() == i);
     producer.join();
 }
+
+test "shared ring between two handles" {
+    const slot_size = @sizeOf(u64);
+    const region = try std.heap.page_allocator.alloc(u8, SharedRing.regionSize(8, slot_size).?);
+    defer std.heap.page_allocator.free(region);
+
+    try std.testing.expectError(error.NotInitialized, SharedRing.attach(region, slot_size));
+    var producer = try SharedRing.create(region, 8, slot_size);
+    var consumer = try SharedRing.attach(region, slot_size);
+    try std.testing.expectError(error.SlotSizeMismatch, SharedRing.attach(region, 4));
+    // the documented header, as shared_ring.hpp reads it
+    try std.testing.expectEqualSlices(u8, "SPRG", region[0..4]);
+    try std.testing.expect(std.mem.readInt(u64, region[8..16], .little) == 8);
+
+    for (0..8) |i| {
+        const value: u64 = i;
+        try std.testing.expect(producer.tryPush(std.mem.asBytes(&value)));
+    }
+    const extra: u64 = 8;
+    try std.testing.expect(!producer.tryPush(std.mem.asBytes(&extra)));
+    try std.testing.expect(consumer.count() == 8);
+
+    for (0..8) |i| {
+        var value: u64 = undefined;
+        try std.testing.expect(consumer.tryPop(std.mem.asBytes(&value)));
+        try std.testing.expect(value == i);
+    }
+    try std.testing.expect(consumer.count() == 0);
+}
+
+test "shared ring reads a region laid out as shared_ring.hpp writes it" {
+    // Built byte by byte from the documented offsets rather than through
+    // create, as the C++ side leaves it after SharedRing::create(region,
+    // size, 4, 8), three pushes of 10, 20, 30 and one pop.
+    const region = try std.heap.page_allocator.alloc(u8, 384 + 4 * 8);
+    defer std.heap.page_allocator.free(region);
+    @memset(region, 0);
+    @memcpy(region[0..4], "SPRG");
+    std.mem.writeInt(u32, region[4..8], 1, .little);
+    std.mem.writeInt(u64, region[8..16], 4, .little);
+    std.mem.writeInt(u64, region[16..24], 8, .little);
+    std.mem.writeInt(u64, region[128..136], 3, .little);
+    std.mem.writeInt(u64, region[256..264], 1, .little);
+    for ([_]u64{ 10, 20, 30 }, 0..) |value, i| std.mem.writeInt(u64, region[384 + i * 8 ..][0..8], value, .little);
+
+    var consumer = try SharedRing.attach(region, 8);
+    var producer = try SharedRing.attach(region, 8);
+    try std.testing.expect(consumer.count() == 2);
+    var value: u64 = undefined;
+    try std.testing.expect(consumer.tryPop(std.mem.asBytes(&value)));
+    try std.testing.expect(value == 20);
+
+    // the next push wraps to slot 3, then slot 0, where C++ will read them
+    const next: u64 = 40;
+    try std.testing.expect(producer.tryPush(std.mem.asBytes(&next)));
+    try std.testing.expect(producer.tryPush(std.mem.asBytes(&next)));
+    try std.testing.expect(std.mem.readInt(u64, region[384 + 3 * 8 ..][0..8], .little) == 40);
+    try std.testing.expect(std.mem.readInt(u64, region[384..392], .little) == 40);
+    try std.testing.expect(std.mem.readInt(u64, region[128..136], .little) == 5);
+    try std.testing.expect(std.mem.readInt(u64, region[256..264], .little) == 2);
+}
+
+test "shared ring rejects a header it can't trust" {
+    const region = try std.heap.page_allocator.alloc(u8, 384 + 4 * 8);
+    defer std.heap.page_allocator.free(region);
+    _ = try SharedRing.create(region, 4, 8);
+
+    for ([_]u64{ 0, 1, 3, 6 }) |capacity| {
+        std.mem.writeInt(u64, region[8..16], capacity, .little);
+        try std.testing.expectError(error.InvalidCapacity, SharedRing.attach(region, 8));
+    }
+    std.mem.writeInt(u64, region[8..16], 8, .little);
+    try std.testing.expectError(error.RegionTooSmall, SharedRing.attach(region, 8));
+    std.mem.writeInt(u64, region[8..16], 1 << 62, .little);
+    try std.testing.expectError(error.SizeOverflow, SharedRing.attach(region, 8));
+    try std.testing.expect(SharedRing.regionSize(1 << 62, 8) == null);
+}